@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <array>
 #include <cstdint>
 #include <iostream>
 #include <stdlib.h>
@@ -31,8 +32,22 @@ namespace cobs
 class Encoder
 {
 public:
+  /** Construct an encoder which collects its output in an internal, growing buffer. */
   Encoder();
 
+  /**
+   * Construct an encoder which writes directly into the caller-owned "buffer" of size "capacity".
+   * The encoder never allocates in this mode, use getMaxEncodedSize() to size the buffer.
+   */
+  Encoder(uint8_t* buffer, size_t capacity);
+
+  /** Construct an encoder which writes directly into a caller-owned std::array. */
+  template<size_t N>
+  explicit Encoder(std::array<uint8_t, N>* buffer);
+
+  Encoder(const Encoder&) = delete;
+  Encoder& operator=(const Encoder&) = delete;
+
   /** Reset the encoder of *this. */
   Encoder& reset();
 
@@ -42,6 +57,15 @@ public:
   /** Feed the encoder with a unsigned short */
   void feed(uint16_t in);
 
+  /** Feed the encoder with "size" bytes starting at "data" */
+  void feed(const uint8_t* data, size_t size);
+
+  /** Feed the encoder with "size" bytes starting at "data" and update "crc" with them in the same pass */
+  void feed(const uint8_t* data, size_t size, uint16_t* crc);
+
+  /** Feed the encoder with "count" segments as one contiguous stream and update "crc" if it is not a nullptr */
+  void feed(const ConstBuffer* segments, size_t count, uint16_t* crc);
+
   /** Feed the encoder with a vector of bytes */
   void feed(const ByteVector& in);
 
@@ -57,21 +81,124 @@ public:
   /** Get the encoding result */
   ByteVector getResult();
 
+  /**
+   * Finish encoding and return the number of encoded bytes in the output buffer.
+   * Returns 0 if the output buffer was too small.
+   */
+  size_t finish();
+
+  /** Check if the output buffer was too small to hold the encoded data. */
+  bool overflow() const;
+
   /** Get the worst-case encoded message size of a message of size "inSize" */
   static constexpr size_t getMaxEncodedSize(size_t inSize);
 
 private:
   void finalizeBlock(uint8_t finalCode);
-
-  ByteVector out_;
+  void put(uint8_t c);
+  void put(const uint8_t* data, size_t size);
+  bool grow();
+
+  ByteVector storage_;
+  uint8_t* out_;
+  size_t capacity_;
+  size_t size_;
+  bool ownsBuffer_;
+  bool overflow_;
   uint8_t code_;
   size_t codeIndex_;
 };
 
-/// Decode everything at once.
+/// Result of decoding a frame
+enum class DecodeStatus
+{
+  Ok,  ///< frame decoded completely
+  Truncated,  ///< input ended within a block
+  InvalidCode,  ///< input contained a zero code byte
+  Overflow,  ///< output buffer too small
+};
+
+/**
+ * Incremental decoder which keeps its state across calls to feed().
+ * Decoded bytes are written into a caller-owned buffer as soon as they arrive. The frame separator (0x00) must not be
+ * fed to the decoder, call finish() when it is received instead.
+ */
+class StreamDecoder
+{
+public:
+  StreamDecoder(uint8_t* buffer, size_t capacity);
+
+  /** Reset the decoder of *this to start a new frame. */
+  StreamDecoder& reset();
+
+  /** Feed the decoder with a single encoded byte */
+  void feed(uint8_t c);
+
+  /** Feed the decoder with "size" encoded bytes starting at "data" */
+  void feed(const uint8_t* data, size_t size);
+
+  /** Finish the current frame and return the decoded size. Returns 0 if the output buffer was too small. */
+  size_t finish();
+
+  /** Check if nothing was fed since the last reset. */
+  bool empty() const;
+
+  /** Check if the output buffer was too small to hold the decoded data. */
+  bool overflow() const;
+
+  /** Get the status of the current frame, call after finish(). */
+  DecodeStatus getStatus() const;
+
+  /** Get the decoded data */
+  const uint8_t* data() const;
+
+  /**
+   * Get the CRC16 (initial value 0xffff) of all decoded bytes except the last two, which carry the checksum of the
+   * frame. It is updated while decoding, valid after finish().
+   */
+  uint16_t getCrc() const;
+
+private:
+  void put(const uint8_t* data, size_t size);
+  void putZeros(size_t size);
+  void decodeCode(uint8_t c);
+  void updateCrc();
+
+  uint8_t* out_;
+  size_t capacity_;
+  size_t size_;
+  size_t literals_;  // literal bytes left in the current block
+  size_t zeros_;  // zeros after the current block, held back until the next block starts
+  size_t crcPos_;  // decoded bytes already covered by crc_
+  uint16_t crc_;
+  bool empty_;
+  bool overflow_;
+  bool invalidCode_;
+};
+
+/**
+ * Find the index of the first zero byte in "data". Returns "size" if there is none.
+ * Scans 32 (AVX2) or 16 (SSE2) bytes at a time where available, with a scalar fallback.
+ */
+size_t findZero(const uint8_t* data, size_t size);
+
+/**
+ * Encode "size" bytes from "in" into the caller-owned buffer "out" of size "outCapacity".
+ * Does not allocate. Returns the encoded size, or 0 if "outCapacity" is too small.
+ */
+size_t encode(const uint8_t* in, size_t size, uint8_t* out, size_t outCapacity);
+
+/// Decode everything at once. Malformed input is silently truncated.
 template<class Iterator>
 ByteVector decode(const Iterator& first, const Iterator& last);
 
+/**
+ * Decode "size" bytes from "in" into the caller-owned buffer "out" of size "outCapacity".
+ * All codes are checked against the end of the input and literal runs are copied with memcpy. The number of decoded
+ * bytes is written to "outSize", also if decoding fails.
+ */
+DecodeStatus decode(const uint8_t* in, size_t size, uint8_t* out, size_t outCapacity, size_t* outSize);
+
 } // end namespace cobs
 } // end namespace asctec_comm
 
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2017 Intel Deutschland GmbH, Germany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace asctec_comm
+{
+
+/**
+ * CRC16 of the bytes in [first, last), starting with "crc".
+ * Uses the same (reflected CCITT, 0x8408) polynomial as trinity_msgs::crc16. The fastest implementation supported by
+ * the CPU is selected at startup.
+ */
+uint16_t crc16(const uint8_t* first, const uint8_t* last, uint16_t crc = 0xffff);
+
+namespace crc
+{
+
+enum class Implementation
+{
+  Table, SlicingBy8, Clmul
+};
+
+/** Byte-wise implementation with a single 256 entry table. */
+uint16_t table(const uint8_t* first, const uint8_t* last, uint16_t crc);
+
+/**
+ * The table used by table(), for callers that add single bytes in a loop: crc = (crc >> 8) ^ t[(crc ^ c) & 0xff].
+ * Avoids the dispatch of crc16() for every byte.
+ */
+const uint16_t* getTable();
+
+/** Processes 8 bytes per step with eight 256 entry tables. */
+uint16_t slicingBy8(const uint8_t* first, const uint8_t* last, uint16_t crc);
+
+/** Folds 16 bytes per step with carry-less multiplication. Only call this if isClmulSupported() returns true. */
+uint16_t clmul(const uint8_t* first, const uint8_t* last, uint16_t crc);
+
+/** Check if the CPU supports the PCLMULQDQ instruction. */
+bool isClmulSupported();
+
+/** Get the implementation used by asctec_comm::crc16(). */
+Implementation getImplementation();
+
+} // end namespace crc
+} // end namespace asctec_comm
@@ -16,12 +16,18 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <thread>
 #include <vector>
 
-#include <asctec_uav_msgs/crc16.h>
-
 #include <asctec_comm/cobs.h>
+#include <asctec_comm/fec.h>
+#include <asctec_comm/frame_pool.h>
 #include <asctec_comm/raw_buffer.h>
 #include <asctec_comm/thread_safe_queue.h>
 #include <asctec_comm/types.h>
@@ -29,6 +35,24 @@
 namespace asctec_comm
 {
 
+/// Snapshot of the counters of a DataLink.
+struct LinkStatistics
+{
+  uint64_t framesSent;
+  uint64_t framesSentSkipped;  // did not fit into the send buffer
+  uint64_t bytesSent;  // encoded bytes accepted by the raw buffer
+  uint64_t partialWrites;  // writes the raw buffer took only part of
+  uint64_t framesReceived;  // frames with a valid checksum
+  uint64_t bytesReceived;  // raw bytes read, including corrupted data
+  uint64_t framesReceivedCrcError;  // including frames with more errors than forward error correction can repair
+  uint64_t framesReceivedRepaired;  // frames repaired by forward error correction
+  uint64_t bytesRepaired;
+  uint64_t framesReceivedMalformed;  // invalid encoding or too short, oversized frames are not counted here
+  uint64_t framesReceivedOverflow;  // exceeded the receive capacity, dropped until the next separator
+  uint64_t sequenceGaps;  // jumps in the sequence numbers of valid frames
+  uint64_t framesLost;  // frames missing according to the sequence numbers
+};
+
 /**
  * \brief Datalink abstraction.
  * Takes care of sending and receiving arbitrary data-frames with a checksum and sequence number.
@@ -36,39 +60,171 @@ namespace asctec_comm
 class DataLink
 {
 public:
-  DataLink(RawBufferPtr rawBuffer);
+  static constexpr size_t kDefaultMaxFrameSize = 2044;
+
+  /**
+   * Called for each valid frame with its data (without sequence number and checksum) and arrival time. The data
+   * points into the decode buffer of the datalink and is only valid during the call.
+   */
+  typedef std::function<void(const uint8_t* data, size_t size, std::chrono::steady_clock::time_point timestamp)> FrameVisitor;
+
+  /**
+   * \param rawBuffer Connection the frames are sent over.
+   * \param maxFrameSize Size of the largest frame that can be sent or received, larger frames are dropped. Both ends
+   * of a link should use the same value. All buffers are sized from it.
+   * \param fecParitySize Enables Reed-Solomon forward error correction with this many parity bytes per 255 byte block
+   * if not 0, which repairs up to fecParitySize / 2 corrupted bytes per block. Both ends of a link must use the same
+   * value.
+   */
+  DataLink(RawBufferPtr rawBuffer, size_t maxFrameSize = kDefaultMaxFrameSize, size_t fecParitySize = 0);
   ~DataLink();
 
+  size_t getMaxFrameSize() const;
+
   /**
    * \brief Sends a frame over the serial port.
+   * The frame is encoded into a preallocated buffer, frames which do not fit are skipped.
+   * If the raw buffer takes only part of the data, the rest is kept and written before anything else. While such a
+   * tail is pending, no new frames are accepted.
+   * @return false if the frame was not accepted because the link is busy, try again later.
+   */
+  bool sendFrame(const ByteVector& frame);
+
+  /**
+   * \brief Sends "nSegments" segments as one frame over the serial port.
+   * The segments are encoded in order without concatenating them first.
+   * @return false if the frame was not accepted because the link is busy, try again later.
+   */
+  bool sendFrame(const ConstBuffer* segments, size_t nSegments);
+
+  /**
+   * \brief Sends "nSegments" segments of at most "kFrameSize" bytes in total as one frame.
+   * The frame is encoded into a stack buffer whose worst-case size is computed at compile time, nothing is allocated.
+   * With forward error correction it is encoded into the send buffer instead. Never waits for another sending thread.
+   * @return false if the frame was not accepted because the link is busy or another thread is sending, try again
+   * later.
+   */
+  template<size_t kFrameSize>
+  bool sendFixedSizeFrame(const ConstBuffer* segments, size_t nSegments);
+
+  /**
+   * \brief Sends "nFrames" frames of "nSegmentsPerFrame" segments each with as few writes as possible.
+   * Frame i consists of segments[i * nSegmentsPerFrame] to segments[(i + 1) * nSegmentsPerFrame - 1]. Each frame gets
+   * its own sequence number, checksum and separator, the frames are encoded back-to-back and written at once.
+   * @return The number of frames accepted, always the first ones. The others have to be sent again once the link is
+   * no longer busy.
+   */
+  size_t sendFrames(const ConstBuffer* segments, size_t nSegmentsPerFrame, size_t nFrames);
+
+  /**
+   * \brief Tries to write data left over from a previous partial write.
+   * @return true if nothing is pending anymore.
+   */
+  bool flush();
+
+  /**
+   * \brief Performs a non blocking read on the raw-buffer (e.g.) serial port, and calls "visitor" for each completed
+   * frame. Nothing is copied, the visitor decides what to keep.
+   * Frames exceeding the maximum frame size are dropped, decoding resumes at the next separator. The arrival time is
+   * taken when the read that contained the separator of the frame returned.
    */
-  void sendFrame(const ByteVector& frame);
+  void pollFrames(const FrameVisitor& visitor);
 
   /**
    * \brief Performs a non blocking read on the raw-buffer (e.g.) serial port, and writes completed frames to frames.
+   * Frames exceeding the maximum frame size are dropped, decoding resumes at the next separator.
+   * The frame buffers come from getFramePool(). Buffers still held by "frames" from a previous call are returned to
+   * the pool first, so passing the same vector on every call does not allocate in steady state.
+   * If "timestamps" is given, it receives the arrival time of each frame, taken when the read that contained its
+   * separator returned.
+   */
+  void pollFramesUnBuffered(std::vector<ByteVector>* frames,
+      std::vector<std::chrono::steady_clock::time_point>* timestamps = nullptr);
+
+  /**
+   * \brief Returns the current counters of the link.
+   * Lock-free, may be called from any thread at any time. The counters are read one by one, so they are not
+   * guaranteed to be consistent with each other.
    */
-  void pollFramesUnBuffered(std::vector<ByteVector>* frames);
+  LinkStatistics getStatistics() const;
+
+  /** Pool the received frames are taken from, hand buffers back with FramePool::release() when done. */
+  FramePoolPtr getFramePool() const;
+
+  /** File descriptor of the raw buffer to wait on for received data, -1 if it has none. */
+  int getFileDescriptor() const;
 
 private:
 
   RawBufferPtr rawBuffer_;
 
   uint16_t sendSequence_;
-  uint16_t receiveSequence_;
-
-  int nFramesSent_;
-  int nFramesSentSkipped_;
-  int nFramesReceived_;
-  int nFramesReceivedMissed_;
-  int nFramesReceivedCrcError_;
-
-  static constexpr int kReceiveBufferSize_ = 2048;
-  uint8_t receiveBuffer_[kReceiveBufferSize_];
-  uint8_t receiveProcessingBuffer_[kReceiveBufferSize_];
-  int receiveProcessingBufferPos_;
+  uint16_t receiveSequence_;  // expected sequence number of the next frame
+  bool receiveSequenceValid_;  // false until the first frame arrived
+
+  // Each counter has a single writer (send path under sendMutex_, receive path), readers use getStatistics().
+  std::atomic<uint64_t> nFramesSent_;
+  std::atomic<uint64_t> nFramesSentSkipped_;
+  std::atomic<uint64_t> nBytesSent_;
+  std::atomic<uint64_t> nPartialWrites_;
+  std::atomic<uint64_t> nFramesReceived_;
+  std::atomic<uint64_t> nBytesReceived_;
+  std::atomic<uint64_t> nFramesReceivedCrcError_;
+  std::atomic<uint64_t> nFramesReceivedRepaired_;
+  std::atomic<uint64_t> nBytesRepaired_;
+  std::atomic<uint64_t> nFramesReceivedMalformed_;
+  std::atomic<uint64_t> nFramesReceivedOverflow_;
+  std::atomic<uint64_t> nSequenceGaps_;
+  std::atomic<uint64_t> nFramesLost_;
+
+  size_t maxFrameSize_;
+  std::unique_ptr<fec::ReedSolomon> fec_;  // nullptr if forward error correction is off
+  size_t codedFrameSize_;  // largest frame including sequence number, checksum and parity, before COBS
+
+  std::mutex sendMutex_;
+  std::vector<uint8_t> sendBuffer_;  // holds at least one encoded frame of maxFrameSize_
+  std::vector<uint8_t> sendFecBuffer_;  // frame is gathered here to compute the parity
+  ByteVector sendPending_;  // not yet written tail of the last write
+
+  std::vector<uint8_t> receiveBuffer_;
+  std::vector<uint8_t> receiveFrameBuffer_;
+  cobs::StreamDecoder receiveDecoder_;
+  bool receiveResync_;  // skipping the remainder of a dropped frame
+
+  static constexpr size_t kFramePoolSize_ = 32;
+  FramePoolPtr framePool_;
+
+  void processReceivedFrame(const FrameVisitor& visitor, std::chrono::steady_clock::time_point timestamp);
+  void checkSequence(uint16_t seq);
+
+  // Writes to the raw buffer and counts the bytes, keeps what was not written in sendPending_. sendMutex_ must be held
+  // and sendPending_ must be empty.
+  void write(uint8_t* data, size_t size);
+
+  // Writes as much of sendPending_ as possible, returns true if it is empty. sendMutex_ must be held.
+  bool flushPending();
+
+  static void increment(std::atomic<uint64_t>* counter, uint64_t n = 1);
+  static size_t getFrameSize(const ConstBuffer* segments, size_t nSegments);
+
+  // Worst-case number of bytes a frame of "frameSize" bytes occupies in the send buffer, including the separator.
+  size_t getMaxEncodedFrameSize(size_t frameSize) const;
+
+  // Appends sequence number, checksum and separator. Returns the encoded size including the separator, 0 if the frame
+  // does not fit. sendMutex_ must be held.
+  size_t finishFrame(cobs::Encoder* encoder, uint16_t crc, uint8_t* buffer);
+
+  // Same as finishFrame(), but takes a frame that already contains sequence number and checksum.
+  size_t terminateFrame(cobs::Encoder* encoder, uint8_t* buffer);
+
+  // Encodes a complete frame with forward error correction into "buffer". Returns the size like finishFrame().
+  // sendMutex_ must be held.
+  size_t encodeFecFrame(const ConstBuffer* segments, size_t nSegments, uint8_t* buffer, size_t capacity);
 };
 
 typedef std::shared_ptr<asctec_comm::DataLink> DataLinkPtr;
 
 }  // end namespace asctec_comm
 
+#include <asctec_comm/implementation/datalink_impl.h>
+
@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2017 Intel Deutschland GmbH, Germany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+
+#include <asctec_comm/types.h>
+
+namespace asctec_comm
+{
+
+/**
+ * \brief XOR delta coding of payloads against the previous payload of the same message id.
+ * Telemetry that changes in a few bytes only turns into mostly zeros, which the COBS variant of the datalink squeezes
+ * out. Every "keyframeInterval"-th message, and whenever the size changes, the full payload is sent instead.
+ */
+namespace delta
+{
+
+enum Flags
+{
+  // High bits of the transport flags, not used by asctec_uav_msgs.
+  FLAG_KEYFRAME = 0x4000,  // full payload, starts a new delta chain
+  FLAG_DELTA = 0x8000,  // payload XOR the previous payload of the same id
+  FLAGS_MASK = FLAG_KEYFRAME | FLAG_DELTA
+};
+
+// A receiver that decodes deltas answers keyframes with FLAG_KEYFRAME and TRANSPORT_FLAG_ACK_RESPONSE, so the sender
+// knows it may send deltas. Older peers deliver keyframes as plain payload and never answer them.
+
+class Encoder
+{
+public:
+  Encoder();
+
+  /**
+   * Enables delta coding for messages of "id", a keyframe is sent every "keyframeInterval" messages.
+   * An interval of 0 disables delta coding for the id again. Thread safe.
+   */
+  void setKeyframeInterval(uint32_t id, unsigned int keyframeInterval);
+
+  /** Check if delta coding is enabled for "id". Thread safe. */
+  bool isEnabled(uint32_t id) const;
+
+  /**
+   * Encodes "payload" of a message with "id" in place.
+   * Sets *flags to FLAG_KEYFRAME or FLAG_DELTA and *seq to the position in the delta chain of the id. Returns false
+   * and leaves everything untouched if delta coding is not enabled for "id". Messages have to be encoded in the order
+   * they are sent. With "keyframeOnly" set, the message becomes a keyframe in any case.
+   */
+  bool encode(uint32_t id, ByteVector* payload, uint16_t* flags, uint16_t* seq, bool keyframeOnly = false);
+
+private:
+  struct State
+  {
+    unsigned int keyframeInterval = 0;
+    unsigned int sinceKeyframe = 0;
+    uint16_t seq = 0;
+    ByteVector last;
+  };
+
+  mutable std::mutex mutex_;
+  std::unordered_map<uint32_t, State> states_;
+  std::atomic<size_t> nEnabled_;  // lets isEnabled() skip the lock if delta coding is not used at all
+};
+
+class Decoder
+{
+public:
+  /**
+   * Decodes a payload with FLAG_KEYFRAME or FLAG_DELTA set in "flags" into *out.
+   * Returns false if a delta cannot be decoded because messages of the chain were lost, everything up to the next
+   * keyframe of the id is dropped then.
+   */
+  bool decode(uint32_t id, uint16_t flags, uint16_t seq, const uint8_t* payload, size_t size, ByteVector* out);
+
+private:
+  struct State
+  {
+    bool valid = false;
+    uint16_t seq = 0;
+    ByteVector last;
+  };
+
+  std::unordered_map<uint32_t, State> states_;
+};
+
+} // end namespace delta
+} // end namespace asctec_comm
@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2017 Intel Deutschland GmbH, Germany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace asctec_comm
+{
+
+namespace fec
+{
+
+/**
+ * \brief Systematic Reed-Solomon code over GF(256) (polynomial 0x11d).
+ * Data is split into blocks of at most 255 bytes including "nParity" parity bytes appended to each block. Up to
+ * nParity / 2 corrupted bytes per block are repaired.
+ */
+class ReedSolomon
+{
+public:
+  static constexpr size_t kMaxBlockSize = 255;
+
+  /** "nParity" must be between 1 and 254. */
+  explicit ReedSolomon(size_t nParity);
+
+  size_t getParitySize() const;
+
+  /** Size of "size" bytes of data after encoding. */
+  size_t getEncodedSize(size_t size) const;
+
+  /** Encode "size" bytes from "in" into "out", which must hold getEncodedSize(size) bytes. Returns the encoded size. */
+  size_t encode(const uint8_t* in, size_t size, uint8_t* out) const;
+
+  /**
+   * Repair and decode "size" encoded bytes in place, the data ends up at the beginning of "data".
+   * @param decodedSize Set to the size of the decoded data.
+   * @param nCorrected Set to the number of repaired bytes, may be nullptr.
+   * @return false if there were more errors than can be repaired.
+   */
+  bool decode(uint8_t* data, size_t size, size_t* decodedSize, size_t* nCorrected) const;
+
+  /** Compute the "nParity" parity bytes of a single block of "size" data bytes. */
+  void encodeBlock(const uint8_t* data, size_t size, uint8_t* parity) const;
+
+  /**
+   * Repair a single block of "size" bytes including parity in place.
+   * Returns the number of repaired bytes or -1 if the block cannot be repaired.
+   */
+  int decodeBlock(uint8_t* block, size_t size) const;
+
+private:
+  size_t nParity_;
+  uint8_t generator_[kMaxBlockSize + 1];  // highest degree first, generator_[0] is 1
+  uint8_t logGenerator_[kMaxBlockSize + 1];  // none of the coefficients is 0
+};
+
+} // end namespace fec
+} // end namespace asctec_comm
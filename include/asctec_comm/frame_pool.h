@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2017 Intel Deutschland GmbH, Germany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <asctec_comm/types.h>
+
+namespace asctec_comm
+{
+
+/**
+ * \brief Recycles frame buffers so receiving does not allocate in steady state.
+ * All buffers have the same capacity, typically the largest frame of the link. Thread safe.
+ */
+class FramePool
+{
+public:
+  /**
+   * \param frameCapacity Capacity of the buffers handed out by the pool.
+   * \param size Number of buffers allocated up front, at most this many are kept for reuse.
+   */
+  FramePool(size_t frameCapacity, size_t size);
+
+  /**
+   * Replaces *frame with an empty buffer of at least getFrameCapacity() bytes capacity.
+   * Only allocates if the pool is exhausted.
+   */
+  void acquire(ByteVector* frame);
+
+  /**
+   * Hands the buffer of *frame back to the pool, *frame is left empty.
+   * Buffers smaller than getFrameCapacity() and buffers exceeding the size of the pool are freed.
+   */
+  void release(ByteVector* frame);
+
+  size_t getFrameCapacity() const;
+
+  /** Number of buffers currently available without allocating */
+  size_t available() const;
+
+private:
+  mutable std::mutex mutex_;
+  std::vector<ByteVector> free_;
+  size_t frameCapacity_;
+  size_t size_;
+};
+
+typedef std::shared_ptr<FramePool> FramePoolPtr;
+
+}  // end namespace asctec_comm
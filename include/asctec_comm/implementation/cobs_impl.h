@@ -16,7 +16,11 @@
 
 #pragma once
 
+#include <algorithm>
+#include <cstring>
+
 #include <asctec_comm/cobs.h>
+#include <asctec_comm/macros.h>
 
 namespace asctec_comm {
 
@@ -57,11 +61,75 @@ static constexpr uint8_t convertZP = (StuffingCode::Diff2Zero - StuffingCode::Di
 // Highest single-zero code with a corresponding double-zero code
 static constexpr uint8_t maxConvertible = (StuffingCode::Diff2ZeroMax - convertZP);
 
+// Split a code into the number of literal bytes and the number of zeros of its block
+inline void splitCode(uint8_t c, size_t* literals, size_t* zeros)
+{
+  if(c == StuffingCode::Diff)
+  {
+    *zeros = 0;
+    *literals = c - 1;
+  }
+  else if(isRunZero(c))
+  {
+    *zeros = c & 0xF;
+    *literals = 0;
+  }
+  else if(isDiff2Zero(c))
+  {
+    *zeros = 2;
+    *literals = c & 0x1F;
+  }
+  else
+  {
+    *zeros = 1;
+    *literals = c > 0 ? c - 1 : 0;
+  }
+}
+
+template<size_t N>
+Encoder::Encoder(std::array<uint8_t, N>* buffer)
+    : Encoder(buffer->data(), N)
+{
+}
+
+constexpr size_t Encoder::getMaxEncodedSize(size_t inSize)
+{
+  return ((inSize) + (inSize) / 208 + 1);
+}
+
+inline void Encoder::put(uint8_t c)
+{
+  if(ASCTEC_UNLIKELY(size_ == capacity_) && !grow())
+  {
+    overflow_ = true;
+    return;
+  }
+  out_[size_++] = c;
+}
+
+inline void Encoder::put(const uint8_t* data, size_t size)
+{
+  while(ASCTEC_UNLIKELY(capacity_ - size_ < size))
+  {
+    if(!grow())
+    {
+      overflow_ = true;
+      size_ = capacity_;
+      return;
+    }
+  }
+  memcpy(out_ + size_, data, size);
+  size_ += size;
+}
+
 inline void Encoder::finalizeBlock(uint8_t finalCode)
 {
-  out_[codeIndex_] = finalCode;  // save code to this' block code position
-  codeIndex_ = out_.size();  // store code position for new block
-  out_.push_back(0);
+  if(codeIndex_ < size_)
+  {
+    out_[codeIndex_] = finalCode;  // save code to this' block code position
+  }
+  codeIndex_ = size_;  // store code position for new block
+  put(0);
 }
 
 inline void Encoder::feed(uint16_t in)
@@ -72,14 +140,19 @@ inline void Encoder::feed(uint16_t in)
   feed(*ptr);
 }
 
-inline void Encoder::feed(const ByteVector& in)
+inline void Encoder::feed(const ConstBuffer* segments, size_t count, uint16_t* crc)
 {
-  for (auto& c : in)
+  for(size_t i = 0; i < count; ++i)
   {
-    feed(c);
+    feed(segments[i].data, segments[i].size, crc);
   }
 }
 
+inline void Encoder::feed(const ByteVector& in)
+{
+  feed(in.data(), in.size());
+}
+
 inline Encoder& Encoder::operator<<(const ByteVector& in)
 {
   feed(in);
@@ -100,53 +173,88 @@ inline Encoder& Encoder::operator<<(uint16_t in)
 
 inline ByteVector Encoder::getResult()
 {
-  out_[codeIndex_] = code_;
+  finish();
+  return ByteVector(out_, out_ + size_);
+}
+
+inline size_t Encoder::finish()
+{
+  if(codeIndex_ < size_)
+  {
+    out_[codeIndex_] = code_;
+  }
+  return overflow_ ? 0 : size_;
+}
+
+inline bool Encoder::overflow() const
+{
+  return overflow_;
+}
+
+inline void StreamDecoder::feed(uint8_t c)
+{
+  feed(&c, 1);
+}
+
+inline bool StreamDecoder::empty() const
+{
+  return empty_;
+}
+
+inline bool StreamDecoder::overflow() const
+{
+  return overflow_;
+}
+
+inline const uint8_t* StreamDecoder::data() const
+{
   return out_;
 }
 
+inline DecodeStatus StreamDecoder::getStatus() const
+{
+  if(overflow_)
+  {
+    return DecodeStatus::Overflow;
+  }
+  if(invalidCode_)
+  {
+    return DecodeStatus::InvalidCode;
+  }
+  if(literals_ > 0)
+  {
+    return DecodeStatus::Truncated;
+  }
+  return DecodeStatus::Ok;
+}
+
+inline uint16_t StreamDecoder::getCrc() const
+{
+  return crc_;
+}
+
 template<class Iterator>
 ByteVector
 decode(const Iterator& first, const Iterator& last)
 {
   std::vector < uint8_t > out;
+  out.reserve(std::distance(first, last));
 
   Iterator it = first;
 
   while(it < last)
   {
-    int32_t z, c = *it++;  // c = code, z = zeros
+    size_t c, z;  // c = code, z = zeros
+    splitCode(*it++, &c, &z);
 
-    if(c == StuffingCode::Diff)
-    {
-      z = 0;
-      c--;
-    }
-    else if(isRunZero (c))
-    {
-      z = c & 0xF;
-      c = 0;
-    }
-    else if(isDiff2Zero (c))
-    {
-      z = 2;
-      c &= 0x1F;
-    }
-    else
-    {
-      z = 1;
-      c--;
-    }
+    // never read past the end, even if the code says so
+    c = std::min<size_t>(c, last - it);
 
-    while(--c >= 0)
-    {
-      out.push_back (*it);
-      ++it;
-    }
+    // copy whole literal runs and zero runs at once
+    out.insert(out.end(), it, it + c);
+    it += c;
 
-    while(--z >= 0)
-    {
-      out.push_back (0);
-    }
+    out.insert(out.end(), z, uint8_t(0));
   }
 
   if(!out.empty ())
@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2017 Intel Deutschland GmbH, Germany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <asctec_comm/datalink.h>
+#include <asctec_comm/macros.h>
+
+namespace asctec_comm
+{
+
+template<size_t kFrameSize>
+bool DataLink::sendFixedSizeFrame(const ConstBuffer* segments, size_t nSegments)
+{
+  if(kFrameSize > maxFrameSize_ && getFrameSize(segments, nSegments) > maxFrameSize_)
+  {
+    ASCTEC_ERROR_STREAM("frame exceeds the maximum frame size of " << maxFrameSize_ << ", skipping");
+    increment(&nFramesSentSkipped_);
+    return true;
+  }
+
+  // The parity needs the whole frame in one piece, it is encoded into the send buffer. Another thread writing counts
+  // as busy, the caller must not wait for it.
+  if(fec_)
+  {
+    std::unique_lock<std::mutex> lock(sendMutex_, std::try_to_lock);
+    if(!lock.owns_lock() || !flushPending())
+    {
+      return false;
+    }
+
+    const size_t size = encodeFecFrame(segments, nSegments, sendBuffer_.data(), sendBuffer_.size());
+    if(size == 0)
+    {
+      ASCTEC_ERROR_STREAM("frame does not fit into the send buffer, skipping");
+      increment(&nFramesSentSkipped_);
+      return true;
+    }
+
+    write(sendBuffer_.data(), size);
+    return true;
+  }
+
+  // frame, sequence number and crc, plus the separator
+  std::array<uint8_t, cobs::Encoder::getMaxEncodedSize(kFrameSize + 4) + 1> buffer;
+
+  // leave space for the separator
+  cobs::Encoder encoder(buffer.data(), buffer.size() - 1);
+
+  // the payload can be encoded before taking the lock, only the sequence number needs it
+  uint16_t crc = 0xffff;
+  encoder.feed(segments, nSegments, &crc);
+
+  std::unique_lock<std::mutex> lock(sendMutex_, std::try_to_lock);
+  if(!lock.owns_lock() || !flushPending())
+  {
+    return false;
+  }
+
+  const size_t size = finishFrame(&encoder, crc, buffer.data());
+  if(size == 0)
+  {
+    ASCTEC_ERROR_STREAM("frame does not fit into the send buffer, skipping");
+    increment(&nFramesSentSkipped_);
+    return true;
+  }
+
+  write(buffer.data(), size);
+  return true;
+}
+
+inline size_t DataLink::getFrameSize(const ConstBuffer* segments, size_t nSegments)
+{
+  size_t size = 0;
+  for(size_t i = 0; i < nSegments; ++i)
+  {
+    size += segments[i].size;
+  }
+  return size;
+}
+
+inline void DataLink::increment(std::atomic<uint64_t>* counter, uint64_t n)
+{
+  counter->fetch_add(n, std::memory_order_relaxed);
+}
+
+}  // end namespace asctec_comm
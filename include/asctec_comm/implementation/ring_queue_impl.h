@@ -0,0 +1,245 @@
+/*
+ * Copyright (C) 2017 Intel Deutschland GmbH, Germany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <thread>
+#include <utility>
+
+#include <asctec_comm/macros.h>
+#include <asctec_comm/ring_queue.h>
+
+namespace asctec_comm
+{
+
+template<typename T>
+constexpr std::chrono::microseconds::rep RingQueue<T>::kSpinMicroseconds_;
+
+template<typename T>
+RingQueue<T>::RingQueue(size_t capacity)
+    : capacity_(capacity), cells_(new Cell[capacity]),
+      spinDuration_(std::thread::hardware_concurrency() > 1 ? kSpinMicroseconds_ : 0), enqueuePos_(0),
+      dequeuePos_(0), nSleeping_(0), interrupted_(false)
+{
+  for(size_t i = 0; i < capacity_; ++i)
+  {
+    cells_[i].sequence.store(i, std::memory_order_relaxed);
+  }
+}
+
+template<typename T>
+bool RingQueue<T>::empty() const
+{
+  return size() == 0;
+}
+
+template<typename T>
+size_t RingQueue<T>::size() const
+{
+  const size_t dequeuePos = dequeuePos_.load(std::memory_order_relaxed);
+  const size_t enqueuePos = enqueuePos_.load(std::memory_order_relaxed);
+  return enqueuePos > dequeuePos ? enqueuePos - dequeuePos : 0;
+}
+
+template<typename T>
+size_t RingQueue<T>::capacity() const
+{
+  return capacity_;
+}
+
+template<typename T>
+void RingQueue<T>::push(T&& data)
+{
+  while(!tryPushImpl(std::move(data)))
+  {
+    T discarded;
+    if(tryPop(&discarded))
+    {
+      ASCTEC_WARN_STREAM("discarded element from RingQueue");
+    }
+  }
+}
+
+template<typename T>
+bool RingQueue<T>::tryPush(T&& data)
+{
+  return tryPushImpl(std::move(data));
+}
+
+template<typename T>
+bool RingQueue<T>::tryPush(T const& data)
+{
+  return tryPushImpl(data);
+}
+
+template<typename T>
+template<class Data>
+bool RingQueue<T>::tryPushImpl(Data&& data)
+{
+  size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+  Cell* cell;
+
+  while(true)
+  {
+    cell = &cells_[pos % capacity_];
+    const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+    const intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+
+    if(diff == 0)
+    {
+      // the cell is free in this round, claim it
+      if(enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+      {
+        break;
+      }
+    }
+    else if(diff < 0)
+    {
+      // still filled from the previous round
+      return false;
+    }
+    else
+    {
+      // another producer was faster
+      pos = enqueuePos_.load(std::memory_order_relaxed);
+    }
+  }
+
+  cell->data = std::forward<Data>(data);
+  cell->sequence.store(pos + 1, std::memory_order_release);
+
+  notify();
+  return true;
+}
+
+template<typename T>
+bool RingQueue<T>::tryPop(T* item)
+{
+  size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+  Cell* cell;
+
+  while(true)
+  {
+    cell = &cells_[pos % capacity_];
+    const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+    const intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+
+    if(diff == 0)
+    {
+      if(dequeuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+      {
+        break;
+      }
+    }
+    else if(diff < 0)
+    {
+      // not filled yet
+      return false;
+    }
+    else
+    {
+      pos = dequeuePos_.load(std::memory_order_relaxed);
+    }
+  }
+
+  if(item)
+  {
+    *item = std::move(cell->data);
+  }
+  else
+  {
+    cell->data = T();
+  }
+
+  // free for the producers of the next round
+  cell->sequence.store(pos + capacity_, std::memory_order_release);
+  return true;
+}
+
+template<typename T>
+template<class Rep, class Period>
+bool RingQueue<T>::popWithTimeout(const std::chrono::duration<Rep, Period>& timeout, T* item)
+{
+  if(tryPop(item))
+  {
+    return true;
+  }
+
+  // Data usually follows soon while the link is busy, polling for a moment avoids a sleep and wakeup.
+  typedef std::chrono::steady_clock Clock;
+  const Clock::duration wait = std::chrono::duration_cast<Clock::duration>(timeout);
+  const Clock::time_point now = Clock::now();
+  const Clock::time_point spinEnd = now + std::min<Clock::duration>(spinDuration_, wait);
+  const Clock::time_point end = now + wait;
+
+  while(Clock::now() < spinEnd)
+  {
+    if(tryPop(item))
+    {
+      return true;
+    }
+    if(interrupted_.exchange(false, std::memory_order_relaxed))
+    {
+      return false;
+    }
+  }
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  nSleeping_.fetch_add(1, std::memory_order_relaxed);
+
+  // pairs with the fence in notify(), either the producer sees the sleeper or this thread sees the element
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+
+  bool success = tryPop(item);
+  bool interrupted = !success && interrupted_.exchange(false, std::memory_order_relaxed);
+  while(!success && !interrupted && condition_.wait_until(lock, end) == std::cv_status::no_timeout)
+  {
+    success = tryPop(item);
+    interrupted = !success && interrupted_.exchange(false, std::memory_order_relaxed);
+  }
+
+  if(!success)
+  {
+    success = tryPop(item);
+  }
+
+  nSleeping_.fetch_sub(1, std::memory_order_relaxed);
+  return success;
+}
+
+template<typename T>
+void RingQueue<T>::interrupt()
+{
+  interrupted_.store(true, std::memory_order_relaxed);
+  notify();
+}
+
+template<typename T>
+void RingQueue<T>::notify()
+{
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+
+  if(nSleeping_.load(std::memory_order_relaxed) > 0)
+  {
+    // the sleeper holds the mutex from its last check until it waits, so the notification cannot get lost
+    std::lock_guard<std::mutex> lock(mutex_);
+    condition_.notify_all();
+  }
+}
+
+}  // end namespace asctec_comm
@@ -53,13 +53,58 @@ void ThreadSafeQueue<T>::push(T const& data)
 {
   UniqueLock lock(mutex_);
   queue_.push_back(data);
-  while(queue_.size() > maximumSize_)
+  shrinkToMaximumSize();
+  lock.unlock();
+  condition_.notify_one();
+}
+
+template<typename T>
+void ThreadSafeQueue<T>::push(T&& data)
+{
+  UniqueLock lock(mutex_);
+  queue_.push_back(std::move(data));
+  shrinkToMaximumSize();
+  lock.unlock();
+  condition_.notify_one();
+}
+
+template<typename T>
+template<class... Args>
+void ThreadSafeQueue<T>::emplace(Args&&... args)
+{
+  UniqueLock lock(mutex_);
+  queue_.emplace_back(std::forward<Args>(args)...);
+  shrinkToMaximumSize();
+  lock.unlock();
+  condition_.notify_one();
+}
+
+template<typename T>
+bool ThreadSafeQueue<T>::tryPush(T const& data)
+{
+  UniqueLock lock(mutex_);
+  if(queue_.size() >= maximumSize_)
   {
-    queue_.pop_front();
-    ASCTEC_WARN_STREAM("discarded element from ThreadSafeQueue");
+    return false;
+  }
+  queue_.push_back(data);
+  lock.unlock();
+  condition_.notify_one();
+  return true;
+}
+
+template<typename T>
+bool ThreadSafeQueue<T>::tryPush(T&& data)
+{
+  UniqueLock lock(mutex_);
+  if(queue_.size() >= maximumSize_)
+  {
+    return false;
   }
+  queue_.push_back(std::move(data));
   lock.unlock();
   condition_.notify_one();
+  return true;
 }
 
 template<typename T>
@@ -70,11 +115,7 @@ void ThreadSafeQueue<T>::push(const Iterator& first, const Iterator& last)
   queue_.insert(queue_.end(), first, last);
 
   // TODO: do this smarter
-  while(queue_.size() > maximumSize_)
-  {
-    queue_.pop_front();
-    ASCTEC_WARN_STREAM("discarded element from ThreadSafeQueue");
-  }
+  shrinkToMaximumSize();
   lock.unlock();
   condition_.notify_one();
 }
@@ -90,7 +131,7 @@ bool ThreadSafeQueue<T>::tryPop(T* item)
 
   if(item)
   {
-    *item = queue_.front();
+    *item = std::move(queue_.front());
     queue_.pop_front();
   }
   return true;
@@ -105,7 +146,7 @@ T ThreadSafeQueue<T>::pop()
     condition_.wait(lock);
   }
 
-  T item = queue_.front();
+  T item = std::move(queue_.front());
   queue_.pop_front();
   return item;
 }
@@ -127,7 +168,7 @@ bool ThreadSafeQueue<T>::popWithTimeout(const std::chrono::duration<Rep, Period>
 
   if(item)
   {
-    *item = queue_.front();
+    *item = std::move(queue_.front());
     queue_.pop_front();
   }
   return true;
@@ -140,4 +181,14 @@ void ThreadSafeQueue<T>::clear()
   queue_.clear();
 }
 
+template<typename T>
+void ThreadSafeQueue<T>::shrinkToMaximumSize()
+{
+  while(queue_.size() > maximumSize_)
+  {
+    queue_.pop_front();
+    ASCTEC_WARN_STREAM("discarded element from ThreadSafeQueue");
+  }
+}
+
 }
@@ -16,6 +16,9 @@
 
 #pragma once
 
+#include <cstring>
+#include <iterator>
+
 #include <asctec_comm/transport.h>
 
 namespace asctec_comm
@@ -23,61 +26,132 @@ namespace asctec_comm
 
 template<class Iterator>
 void Transport::serialize(uint32_t id, uint16_t flags, uint16_t ackId, const Iterator& first, const Iterator& last,
-    ByteVector* frame)
+    Frame* frame)
 {
   if(frame)
   {
-    frame->clear();
-    frame->reserve(4 + 2 + 2 + std::distance(first, last));
-    frame->insert(frame->begin() + POS_ID, (uint8_t*)&id, ((uint8_t*)&id) + 4);
-    frame->insert(frame->begin() + POS_FLAGS, (uint8_t*)&flags, ((uint8_t*)&flags) + 2);
-    frame->insert(frame->begin() + POS_ACK_ID, (uint8_t*)&ackId, ((uint8_t*)&ackId) + 2);
-    frame->insert(frame->begin() + POS_DATAGRAM, first, last);
+    serializeHeader(id, flags, ackId, frame->header_);
+    frame->payload_.assign(first, last);
+  }
+}
+
+inline bool Transport::queueFrame(Frame&& frame)
+{
+  // counted before the push, so the send thread never sees more frames than are counted
+  ++nFramesQueued_;
+  if(!sendQueue_.tryPush(std::move(frame)))
+  {
+    --nFramesQueued_;
+    return false;
   }
+  return true;
+}
+
+inline void Transport::serializeHeader(uint32_t id, uint16_t flags, uint16_t ackId, uint8_t* header)
+{
+  memcpy(header + POS_ID, &id, sizeof(id));
+  memcpy(header + POS_FLAGS, &flags, sizeof(flags));
+  memcpy(header + POS_ACK_ID, &ackId, sizeof(ackId));
+}
+
+inline void Transport::deserializeHeader(const uint8_t* header, int32_t* id, uint16_t* flags, uint16_t* ackId)
+{
+  memcpy(id, header + POS_ID, sizeof(*id));
+  memcpy(flags, header + POS_FLAGS, sizeof(*flags));
+  memcpy(ackId, header + POS_ACK_ID, sizeof(*ackId));
 }
 
 template<class Iterator>
-void Transport::sendData(uint32_t id, const Iterator& first, const Iterator& last)
+bool Transport::sendData(uint32_t id, const Iterator& first, const Iterator& last)
 {
-  ByteVector frame;
+  if(!checkDatagramSize(std::distance(first, last)))
+  {
+    return false;
+  }
+
+  Frame frame;
   serialize(id, 0, 0, first, last, &frame);
-  sendQueue_.push(frame);
+  return queueFrame(std::move(frame));
 }
 
-inline void Transport::sendData(uint32_t id, const ByteVector& data)
+inline bool Transport::sendData(uint32_t id, const ByteVector& data)
 {
-  sendData(id, data.begin(), data.end());
+  return sendData(id, data.begin(), data.end());
+}
+
+inline bool Transport::sendData(uint32_t id, ByteVector&& data)
+{
+  if(!checkDatagramSize(data.size()))
+  {
+    return false;
+  }
+
+  Frame frame;
+  serializeHeader(id, 0, 0, frame.header_);
+  frame.payload_.swap(data);
+
+  if(!queueFrame(std::move(frame)))
+  {
+    // not sent, the caller keeps its data
+    data.swap(frame.payload_);
+    return false;
+  }
+  return true;
 }
 
 template<class Data>
-void Transport::sendData(uint32_t id, const Data& data)
+bool Transport::sendData(uint32_t id, const Data& data)
 {
-  sendData(id, reinterpret_cast<const uint8_t*>(&data), reinterpret_cast<const uint8_t*>(&data) + sizeof(Data));
+  return sendData(id, data, std::is_trivially_copyable<Data>());
 }
 
-template<class Rep, class Period, class Iterator>
-bool Transport::sendDataAcknowledged(const std::chrono::duration<Rep, Period>& timeout, uint32_t id,
-    const Iterator& first, const Iterator& last)
+template<class Data>
+bool Transport::sendData(uint32_t id, const Data& data, std::true_type)
 {
-  uint16_t ackId;
-  ByteVector frame;
+  if(!checkDatagramSize(sizeof(Data)))
   {
-    UniqueLock lock(ackMutex_);
-    ackId = nextAckId_;
-    ++nextAckId_;
+    return false;
+  }
+
+  // delta coding is done by the send thread
+  if(deltaEncoder_.isEnabled(id))
+  {
+    return sendData(id, data, std::false_type());
   }
-  serialize(id, asctec_uav_msgs::TRANSPORT_FLAG_ACK_REQUEST, ackId, first, last, &frame);
-  sendQueue_.push(frame);
-
-  UniqueLock lock(ackMutex_);
-  auto timenow = std::chrono::system_clock::now();
-  bool success = ackCondition_.wait_until(lock, timeout + timenow, [this, ackId]
-  { return this->pendingAcks_.find(ackId) != this->pendingAcks_.end();});
-  if(success)
+
+  uint8_t header[POS_DATAGRAM];
+  serializeHeader(id, 0, 0, header);
+
+  // Writing directly would overtake frames still waiting for the send thread, and a busy link would hold up the
+  // caller. The send thread takes the struct in both cases.
+  const ConstBuffer segments[] = { { header, POS_DATAGRAM }, { reinterpret_cast<const uint8_t*>(&data), sizeof(Data) } };
+  if(nFramesQueued_ == 0 && dataLink_->sendFixedSizeFrame<POS_DATAGRAM + sizeof(Data)>(segments, 2))
   {
-    pendingAcks_.erase(ackId);
+    return true;
   }
-  return success;
+  return sendData(id, data, std::false_type());
+}
+
+template<class Data>
+bool Transport::sendData(uint32_t id, const Data& data, std::false_type)
+{
+  return sendData(id, reinterpret_cast<const uint8_t*>(&data), reinterpret_cast<const uint8_t*>(&data) + sizeof(Data));
+}
+
+template<class Rep, class Period, class Iterator>
+bool Transport::sendDataAcknowledged(const std::chrono::duration<Rep, Period>& timeout, uint32_t id,
+    const Iterator& first, const Iterator& last)
+{
+  // completed by the receive or the send thread, the promise has to outlive this call
+  std::shared_ptr<std::promise<bool>> promise = std::make_shared<std::promise<bool>>();
+  std::future<bool> future = promise->get_future();
+
+  sendDataAcknowledgedAsync(timeout, id, first, last, [promise](bool acknowledged)
+  {
+    promise->set_value(acknowledged);
+  });
+
+  return future.get();
 }
 
 template<class Rep, class Period>
@@ -94,8 +168,76 @@ bool Transport::sendDataAcknowledged(const std::chrono::duration<Rep, Period>& t
       reinterpret_cast<const uint8_t*>(&data) + sizeof(Data));
 }
 
+template<class Rep, class Period, class Iterator>
+void Transport::sendDataAcknowledgedAsync(const std::chrono::duration<Rep, Period>& timeout, uint32_t id,
+    const Iterator& first, const Iterator& last, const AckCallback& callback)
+{
+  if(!checkDatagramSize(std::distance(first, last)))
+  {
+    callback(false);
+    return;
+  }
+
+  Frame frame;
+  serialize(id, asctec_uav_msgs::TRANSPORT_FLAG_ACK_REQUEST, 0, first, last, &frame);
+  sendAcknowledged(&frame, std::chrono::duration_cast<std::chrono::steady_clock::duration>(timeout), callback);
+}
+
+template<class Rep, class Period>
+void Transport::sendDataAcknowledgedAsync(const std::chrono::duration<Rep, Period>& timeout, uint32_t id,
+    const ByteVector& data, const AckCallback& callback)
+{
+  sendDataAcknowledgedAsync(timeout, id, data.begin(), data.end(), callback);
+}
+
+template<class Rep, class Period, class Data>
+void Transport::sendDataAcknowledgedAsync(const std::chrono::duration<Rep, Period>& timeout, uint32_t id,
+    const Data& data, const AckCallback& callback)
+{
+  sendDataAcknowledgedAsync(timeout, id, reinterpret_cast<const uint8_t*>(&data),
+      reinterpret_cast<const uint8_t*>(&data) + sizeof(Data), callback);
+}
+
+template<class Rep, class Period>
+std::future<bool> Transport::sendDataAcknowledgedAsync(const std::chrono::duration<Rep, Period>& timeout, uint32_t id,
+    const ByteVector& data)
+{
+  std::shared_ptr<std::promise<bool>> promise = std::make_shared<std::promise<bool>>();
+  std::future<bool> future = promise->get_future();
+
+  sendDataAcknowledgedAsync(timeout, id, data.begin(), data.end(), [promise](bool acknowledged)
+  {
+    promise->set_value(acknowledged);
+  });
+
+  return future;
+}
+
+template<class Rep, class Period, class Data>
+std::future<bool> Transport::sendDataAcknowledgedAsync(const std::chrono::duration<Rep, Period>& timeout, uint32_t id,
+    const Data& data)
+{
+  std::shared_ptr<std::promise<bool>> promise = std::make_shared<std::promise<bool>>();
+  std::future<bool> future = promise->get_future();
+
+  sendDataAcknowledgedAsync(timeout, id, reinterpret_cast<const uint8_t*>(&data),
+      reinterpret_cast<const uint8_t*>(&data) + sizeof(Data), [promise](bool acknowledged)
+      {
+        promise->set_value(acknowledged);
+      });
+
+  return future;
+}
+
 template<class Rep, class Period>
 bool Transport::waitForData(const std::chrono::duration<Rep, Period>& timeout, uint32_t* id, ByteVector* data)
+{
+  return waitForData(timeout, id, data, nullptr);
+}
+
+template<class Rep, class Period>
+bool Transport::waitForData(const std::chrono::duration<Rep, Period>& timeout, uint32_t* id, ByteVector* data,
+    std::chrono::steady_clock::time_point* timestamp)
 {
   Datagram datagram;
   bool success = receiveQueue_.popWithTimeout(timeout, &datagram);
@@ -112,6 +254,12 @@ bool Transport::waitForData(const std::chrono::duration<Rep, Period>& timeout, u
   if(data)
   {
     data->swap(datagram.data_);  // no copy :)
+    framePool_->release(&datagram.data_);
+  }
+
+  if(timestamp)
+  {
+    *timestamp = datagram.timestamp_;
   }
   return true;
 }
@@ -34,6 +34,12 @@ public:
 
   /// Reads from buffer, should be blocking with timeout.
   virtual int readBuffer(uint8_t* data, int size) = 0;
+
+  /// File descriptor that becomes readable when data arrives, -1 if there is none to wait on.
+  virtual int getFileDescriptor() const
+  {
+    return -1;
+  }
 };
 
 typedef std::shared_ptr<RawBuffer> RawBufferPtr;
@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2017 Intel Deutschland GmbH, Germany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <chrono>
+
+namespace asctec_comm
+{
+
+/**
+ * \brief Sleeps until a file descriptor becomes readable or another thread calls wakeup().
+ * Built on epoll and an eventfd, so it is only available on Linux. Elsewhere, or if setting it up failed, isValid()
+ * returns false and the caller has to fall back to polling.
+ */
+class Reactor
+{
+public:
+  explicit Reactor(int fd);
+  ~Reactor();
+
+  Reactor(const Reactor&) = delete;
+  Reactor& operator=(const Reactor&) = delete;
+
+  bool isValid() const;
+
+  /**
+   * \brief Waits up to "timeout" for the file descriptor to become readable.
+   * @return true if it is readable, false on timeout, wakeup() or error.
+   */
+  bool wait(const std::chrono::milliseconds& timeout);
+
+  /** Makes a pending or the next wait() return immediately. Thread-safe. */
+  void wakeup();
+
+private:
+  int fd_;
+  int epollFd_;
+  int eventFd_;
+};
+
+} // end namespace asctec_comm
@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2017 Intel Deutschland GmbH, Germany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+
+namespace asctec_comm
+{
+
+/**
+ * \brief Bounded lock-free queue for any number of producers and consumers.
+ * Elements live in a ring of cells, each with a sequence number telling whether it is free or filled for the current
+ * round (D. Vyukov's bounded MPMC queue). Pushing and popping are a compare-and-swap on the position and a move of
+ * the element, no lock is taken. Waiting consumers spin briefly and then sleep, producers only take a lock to wake
+ * them up if somebody actually sleeps.
+ * Same interface as the ThreadSafeQueue parts Transport uses. T has to be default constructible.
+ * Pays off in throughput under contention. A consumer that went to sleep wakes up no faster than with
+ * ThreadSafeQueue, both wait on a condition variable then.
+ */
+template<typename T>
+class RingQueue
+{
+public:
+  explicit RingQueue(size_t capacity);
+
+  RingQueue(const RingQueue&) = delete;
+  RingQueue& operator=(const RingQueue&) = delete;
+
+  bool empty() const;
+
+  /// Number of elements, only approximate while other threads push or pop.
+  size_t size() const;
+
+  size_t capacity() const;
+
+  /// Discards the oldest element if the queue is full, it is destroyed. Use tryPush() to recycle it instead.
+  void push(T&& data);
+
+  /// Fails if the queue is full. "data" is only moved from on success.
+  bool tryPush(T&& data);
+  bool tryPush(T const& data);
+
+  bool tryPop(T* item);
+
+  /// Returns false early if interrupt() is called while waiting, or was called since the last wait.
+  template<class Rep, class Period>
+  bool popWithTimeout(const std::chrono::duration<Rep, Period>& timeout, T* item);
+
+  /// Makes the current or next popWithTimeout() return without waiting for the timeout.
+  void interrupt();
+
+private:
+  struct Cell
+  {
+    std::atomic<size_t> sequence;
+    T data;
+  };
+
+  // a consumer polls this long before it goes to sleep, if there is another core for the producer to run on
+  static constexpr std::chrono::microseconds::rep kSpinMicroseconds_ = 20;
+
+  template<class Data>
+  bool tryPushImpl(Data&& data);
+
+  void notify();
+
+  const size_t capacity_;
+  std::unique_ptr<Cell[]> cells_;
+  const std::chrono::microseconds spinDuration_;
+
+  // producers and consumers each have their own cache line
+  char padding0_[64];
+  std::atomic<size_t> enqueuePos_;
+  char padding1_[64];
+  std::atomic<size_t> dequeuePos_;
+  char padding2_[64];
+
+  std::atomic<int> nSleeping_;
+  std::atomic<bool> interrupted_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+};
+
+}  // end namespace asctec_comm
+
+#include <asctec_comm/implementation/ring_queue_impl.h>
@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2017 Intel Deutschland GmbH, Germany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <memory>
+
+#include <asctec_comm/raw_buffer.h>
+
+namespace asctec_comm
+{
+
+/// Properties of a simulated serial link, the same in both directions.
+struct SimulatedLinkParameters
+{
+  int baudRate = 115200;  // 10 bits per byte, start and stop bit included
+  std::chrono::microseconds latency = std::chrono::microseconds(0);  // one-way, on top of the transmission time
+  size_t txFifoSize = 4096;  // bytes waiting for transmission, writes are partial once it is full
+  std::chrono::microseconds readTimeout = std::chrono::milliseconds(10);
+
+  double bitErrorRate = 0.0;  // probability of each bit to flip
+  double byteDropRate = 0.0;  // probability of each byte to get lost
+  double burstErrorRate = 0.0;  // probability of a burst of random bytes to start at each byte
+  size_t burstLength = 8;
+
+  unsigned int seed = 0;  // the error model is reproducible for a given seed
+};
+
+/// Counters of one direction of a simulated link.
+struct SimulatedLinkStatistics
+{
+  uint64_t bytesWritten;
+  uint64_t bytesDropped;
+  uint64_t bytesCorrupted;
+};
+
+/**
+ * \brief One end of a simulated serial link.
+ * Bytes are paced according to the baud rate, arrive after the configured latency and pass an error model on the
+ * way. Reads return what has arrived so far and wait up to the read timeout for the first byte. Writes return
+ * immediately and take only as much as fits into the TX FIFO, like a nonblocking file descriptor.
+ * Use it to benchmark DataLink and Transport with realistic timing.
+ */
+class SimulatedLink : public RawBuffer
+{
+public:
+  /** Creates both ends of a link. */
+  static void createPair(const SimulatedLinkParameters& parameters, std::shared_ptr<SimulatedLink>* a,
+      std::shared_ptr<SimulatedLink>* b);
+
+  virtual int writeBuffer(uint8_t* data, int size);
+  virtual int readBuffer(uint8_t* data, int size);
+
+  /** Counters of the direction this end transmits on. */
+  SimulatedLinkStatistics getTxStatistics() const;
+
+private:
+  class Channel;
+
+  SimulatedLink(std::shared_ptr<Channel> rx, std::shared_ptr<Channel> tx);
+
+  std::shared_ptr<Channel> rx_;
+  std::shared_ptr<Channel> tx_;
+};
+
+typedef std::shared_ptr<SimulatedLink> SimulatedLinkPtr;
+
+} // end namespace asctec_comm
@@ -19,6 +19,7 @@
 #include <condition_variable>
 #include <mutex>
 #include <deque>
+#include <utility>
 
 namespace asctec_comm
 {
@@ -33,10 +34,23 @@ public:
   size_t size() const;
 
   void push(T const& data);
+  void push(T&& data);
+
+  /// Constructs the element in place from "args".
+  template<class... Args>
+  void emplace(Args&&... args);
+
+  /// Like push(), but fails instead of discarding the oldest element if the queue is full.
+  bool tryPush(T const& data);
+
+  /// Like push(), but fails instead of discarding the oldest element if the queue is full. "data" is only moved from
+  /// on success, so it can be pushed again later.
+  bool tryPush(T&& data);
 
   template<class Iterator>
   void push(const Iterator& first, const Iterator& last);
 
+  /// Pops move the element out of the queue.
   bool tryPop(T* item);
   T pop();
 
@@ -52,6 +66,9 @@ private:
   std::condition_variable condition_;
   size_t maximumSize_;
   bool shutdownRequested_;
+
+  // Discards the oldest elements until the queue fits its maximum size, the lock must be held.
+  void shrinkToMaximumSize();
 };
 
 }  // end namespace asctec_comm
@@ -16,32 +16,117 @@
 
 #pragma once
 
+#include <atomic>
 #include <chrono>
+#include <deque>
+#include <functional>
+#include <future>
+#include <map>
 #include <thread>
-#include <unordered_set>
+#include <type_traits>
+#include <unordered_map>
 
 #include <asctec_comm/datalink.h>
-#include <asctec_comm/thread_safe_queue.h>
+#include <asctec_comm/delta.h>
+#include <asctec_comm/reactor.h>
+#include <asctec_comm/ring_queue.h>
 #include <asctec_comm/types.h>
 #include <asctec_uav_msgs/transport_definitions.h>
 
 namespace asctec_comm
 {
 
+/// Retransmission of acknowledged messages, see Transport::setRetransmissionPolicy().
+struct RetransmissionPolicy
+{
+  unsigned int maxAttempts = 3;  // transmissions including the first one, 1 turns retransmission off
+  std::chrono::milliseconds initialTimeout = std::chrono::milliseconds(250);  // until a round trip was measured
+  std::chrono::milliseconds minTimeout = std::chrono::milliseconds(10);
+  std::chrono::milliseconds maxTimeout = std::chrono::milliseconds(2000);
+};
+
+/// Round trip estimate and counters of acknowledged messages.
+struct AckStatistics
+{
+  uint64_t messagesSent;
+  uint64_t retransmissions;
+  uint64_t messagesAcknowledged;
+  uint64_t messagesFailed;
+  std::chrono::microseconds smoothedRtt;  // 0 until the first round trip was measured
+  std::chrono::microseconds rttVariation;
+  std::chrono::microseconds retransmissionTimeout;  // for the first transmission of the next message
+};
+
 class Transport
 {
 public:
+  /// Receives the payload of a datagram, "data" is valid only during the call.
+  typedef std::function<void(uint32_t id, const uint8_t* data, size_t size,
+      std::chrono::steady_clock::time_point timestamp)> DataCallback;
+
+  /// Runs a task somewhere else, e.g. by posting it to a thread pool or event loop.
+  typedef std::function<void(const std::function<void()>& task)> Executor;
+
+  /// Completion of an acknowledged send, false if it timed out or could not be queued.
+  typedef std::function<void(bool acknowledged)> AckCallback;
+
+  /// Acknowledged messages in flight at once unless changed with setAckWindow().
+  static constexpr size_t kDefaultAckWindow = 32;
+
+  /// Acknowledged messages waiting for room in the window, further ones fail right away.
+  static constexpr size_t kMaxAckBacklog = 32768;
+
+  /**
+   * If the raw buffer of "dataLink" has a file descriptor, the receive thread sleeps in epoll until data arrives
+   * (Linux only). Otherwise it polls and relies on the read timeout of the raw buffer.
+   */
   Transport(std::shared_ptr<DataLink> dataLink);
   ~Transport();
 
+  /**
+   * Queues data for sending.
+   * @return false if the send queue is full because the link cannot keep up or the data exceeds
+   * getMaxDatagramSize(), the data is not sent then.
+   */
   template<class Iterator>
-  void sendData(uint32_t id, const Iterator& first, const Iterator& last);
+  bool sendData(uint32_t id, const Iterator& first, const Iterator& last);
 
-  void sendData(uint32_t id, const ByteVector& data);
+  bool sendData(uint32_t id, const ByteVector& data);
 
+  /// Takes over the buffer of "data" instead of copying it, "data" is left empty if it was sent.
+  bool sendData(uint32_t id, ByteVector&& data);
+
+  /**
+   * Sends a struct. While nothing else waits to be sent and the link is idle, trivially copyable structs are encoded on
+   * the stack and written by the calling thread, so this does not allocate. Otherwise they are queued like any other
+   * data, behind the frames sent before.
+   * @return false if the struct was not sent because the send queue is full or it exceeds getMaxDatagramSize().
+   */
   template<class Data>
-  void sendData(uint32_t id, const Data& data);
+  bool sendData(uint32_t id, const Data& data);
+
+  /// Number of frames waiting to be sent, grows when the link cannot keep up.
+  size_t getSendQueueSize() const;
 
+  /// Largest datagram that fits into a frame of the datalink.
+  size_t getMaxDatagramSize() const;
+
+  /**
+   * Sends messages of "id" as XOR delta to the previous message of the same id, with a full keyframe every
+   * "keyframeInterval" messages. Pays off for telemetry where only a few bytes change between messages. An interval
+   * of 0 turns it off again. Acknowledged messages are always sent in full.
+   * Both ends must run a delta-aware Transport, older peers and existing firmware would take deltas for payload. So
+   * only keyframes, which they receive as plain payload, are sent until the other side answered one and thereby
+   * showed that it decodes deltas. Only the sending side needs to enable it.
+   */
+  void setDeltaEncoding(uint32_t id, unsigned int keyframeInterval);
+
+  /**
+   * Sends data and waits until the other side acknowledged it or "timeout" passed.
+   * Unacknowledged messages are retransmitted by default, up to 3 transmissions in total, so the other side may get
+   * a message more than once. Earlier versions sent each message exactly once, use a RetransmissionPolicy with
+   * maxAttempts = 1 for that.
+   */
   template<class Rep, class Period, class Iterator>
   bool sendDataAcknowledged(const std::chrono::duration<Rep, Period>& timeout, uint32_t id, const Iterator& first,
       const Iterator& last);
@@ -52,9 +137,82 @@ public:
   template<class Rep, class Period, class Data>
   bool sendDataAcknowledged(const std::chrono::duration<Rep, Period>& timeout, uint32_t id, const Data& data);
 
+  /**
+   * Sends data acknowledged without waiting. "callback" is called exactly once, from the receive thread when the
+   * acknowledgement arrives, from the send thread when "timeout" passed, or right away if the message could not be
+   * queued. It must not block. Messages beyond the ack window wait until earlier ones complete, their timeout runs
+   * from this call and is checked once there is room for them. More than kMaxAckBacklog waiting messages fail.
+   */
+  template<class Rep, class Period, class Iterator>
+  void sendDataAcknowledgedAsync(const std::chrono::duration<Rep, Period>& timeout, uint32_t id, const Iterator& first,
+      const Iterator& last, const AckCallback& callback);
+
+  template<class Rep, class Period>
+  void sendDataAcknowledgedAsync(const std::chrono::duration<Rep, Period>& timeout, uint32_t id, const ByteVector& data,
+      const AckCallback& callback);
+
+  template<class Rep, class Period, class Data>
+  void sendDataAcknowledgedAsync(const std::chrono::duration<Rep, Period>& timeout, uint32_t id, const Data& data,
+      const AckCallback& callback);
+
+  /// Like the callback version, the future becomes true once the message is acknowledged.
+  template<class Rep, class Period>
+  std::future<bool> sendDataAcknowledgedAsync(const std::chrono::duration<Rep, Period>& timeout, uint32_t id,
+      const ByteVector& data);
+
+  template<class Rep, class Period, class Data>
+  std::future<bool> sendDataAcknowledgedAsync(const std::chrono::duration<Rep, Period>& timeout, uint32_t id,
+      const Data& data);
+
+  /// Maximum number of acknowledged messages in flight, must be below 32768 so ack ids are not reused too early.
+  void setAckWindow(size_t window);
+
+  /**
+   * An acknowledged message is sent again if its ack does not arrive within the retransmission timeout (RTO), up to
+   * "maxAttempts" times in total, but never after the timeout given by the caller. The RTO follows the measured round
+   * trip time as in RFC 6298 and doubles with every retransmission of a message. Round trips are timed from when the
+   * send thread hands the message to the datalink, time spent in the send queue does not count. Round trips of
+   * retransmitted messages are not measured, as it is unknown which transmission the ack belongs to.
+   * The other side may receive a message more than once if an ack gets lost.
+   * Retransmission is on by default with the values of RetransmissionPolicy. Timeouts are served by the send thread
+   * without waiting for its idle poll.
+   */
+  void setRetransmissionPolicy(const RetransmissionPolicy& policy);
+
+  AckStatistics getAckStatistics() const;
+
+  /**
+   * Waits for a datagram. The previous buffer of "data" is recycled, so passing the same vector on every call avoids
+   * allocations.
+   */
   template<class Rep, class Period>
   bool waitForData(const std::chrono::duration<Rep, Period>& timeout, uint32_t* id, ByteVector* data);
 
+  /**
+   * Waits for a datagram and also returns the time it arrived at the datalink, before it was queued. Use this to
+   * compensate the transport latency.
+   */
+  template<class Rep, class Period>
+  bool waitForData(const std::chrono::duration<Rep, Period>& timeout, uint32_t* id, ByteVector* data,
+      std::chrono::steady_clock::time_point* timestamp);
+
+  /**
+   * Calls "callback" for every datagram of "id" instead of queuing it for waitForData(). Replaces an earlier
+   * subscription of the same id.
+   * Without "executor" the callback runs on the receive thread straight from the receive buffer, nothing is copied,
+   * but it should return quickly as it holds up all other messages. With "executor" the payload is copied and the
+   * callback is handed to it as a task.
+   */
+  void subscribe(uint32_t id, const DataCallback& callback, const Executor& executor = Executor());
+
+  void unsubscribe(uint32_t id);
+
+  /**
+   * Datagrams of ids without a subscription are queued for waitForData() by default. Turn this off if all consumers
+   * subscribe, the others are then dropped before their payload is copied.
+   */
+  void setQueueUnsubscribed(bool queue);
+
 private:
   enum
   {
@@ -65,23 +223,83 @@ private:
   {
     int32_t id_;
     ByteVector data_;
+    std::chrono::steady_clock::time_point timestamp_;
+  };
+
+  // Header and payload are kept apart and handed to the datalink as segments.
+  struct Frame
+  {
+    uint8_t header_[POS_DATAGRAM];
+    ByteVector payload_;
+  };
+
+  struct Subscription
+  {
+    DataCallback callback;
+    Executor executor;
   };
 
+  typedef std::shared_ptr<const Subscription> SubscriptionPtr;
+
+  // in-flight ack ids by the time of their next retransmission or timeout
+  typedef std::multimap<std::chrono::steady_clock::time_point, uint16_t> AckTimeouts;
+
+  struct PendingAck
+  {
+    Frame frame;  // kept for retransmissions
+    AckCallback callback;
+    std::chrono::steady_clock::time_point deadline;  // given by the caller
+    std::chrono::steady_clock::time_point sent;  // last transmission written to the datalink, unset until then
+    std::chrono::steady_clock::time_point retransmit;  // next retransmission, or giving up after the last attempt
+    std::chrono::steady_clock::duration timeout;  // of the last transmission
+    unsigned int nAttempts;  // 0 while it waits in ackBacklog_ for the window
+    AckTimeouts::iterator timeoutEntry;  // in ackTimeouts_ while in flight
+  };
+
+  // frames of acknowledged messages to be queued once ackMutex_ is released, with their ack ids
+  typedef std::vector<std::pair<uint16_t, Frame>> Transmissions;
+
   typedef std::unique_lock<std::mutex> UniqueLock;
 
-  ThreadSafeQueue<ByteVector> sendQueue_;
-  ThreadSafeQueue<Datagram> receiveQueue_;
+  RingQueue<Frame> sendQueue_;  // many user threads and the receive thread push, the send thread pops
+  std::atomic<size_t> nFramesQueued_;  // pushed to sendQueue_ and not yet accepted by the datalink
+  RingQueue<Datagram> receiveQueue_;
 
   std::shared_ptr<DataLink> dataLink_;
+  FramePoolPtr framePool_;
 
   std::thread sendThread_;
   std::thread receiveThread_;
+  std::unique_ptr<Reactor> receiveReactor_;  // nullptr if the raw buffer has no file descriptor to wait on
 
-  std::mutex ackMutex_;
-  std::condition_variable ackCondition_;
-  std::unordered_set<uint16_t> pendingAcks_;
+  mutable std::mutex ackMutex_;
+  std::unordered_map<uint16_t, PendingAck> pendingAcks_;  // in flight, the ack id is assigned on entering the window
+  AckTimeouts ackTimeouts_;
+  std::deque<PendingAck> ackBacklog_;  // messages waiting for room in the window
+  size_t ackWindow_;
+  size_t nAcksInFlight_;
   uint16_t nextAckId_;
 
+  // round trip estimator, guarded by ackMutex_ as well
+  RetransmissionPolicy retransmissionPolicy_;
+  bool rttValid_;
+  std::chrono::steady_clock::duration smoothedRtt_;
+  std::chrono::steady_clock::duration rttVariation_;
+  std::chrono::steady_clock::duration retransmissionTimeout_;
+  AckStatistics ackStatistics_;
+
+  delta::Encoder deltaEncoder_;
+  delta::Decoder deltaDecoder_;  // only used by the receive thread
+  ByteVector receiveDeltaBuffer_;  // decoded delta frames for callbacks on the receive thread
+
+  // Looked up once per received datagram. Entries are immutable and shared, so the receive thread only copies a
+  // pointer and runs the callback without holding the lock.
+  std::mutex subscriptionMutex_;
+  std::unordered_map<uint32_t, SubscriptionPtr> subscriptions_;
+  std::atomic<bool> queueUnsubscribed_;
+
+  std::atomic<bool> peerDecodesDelta_;  // the other side answered a keyframe, deltas are safe to send
+
   bool shutdownRequested_;
 
   void sendThread();
@@ -89,9 +307,63 @@ private:
 
   template<class Iterator>
   static void serialize(uint32_t id, uint16_t flags, uint16_t ackId, const Iterator& first, const Iterator& last,
-      ByteVector* frame);
+      Frame* frame);
+
+  static void serializeHeader(uint32_t id, uint16_t flags, uint16_t ackId, uint8_t* header);
+
+  // Pushes "frame" to the send queue, returns false and leaves "frame" alone if the queue is full.
+  bool queueFrame(Frame&& frame);
+
+  // Logs an error and returns false if a datagram of "size" bytes does not fit into a frame.
+  bool checkDatagramSize(size_t size) const;
+
+  template<class Data>
+  bool sendData(uint32_t id, const Data& data, std::true_type isTriviallyCopyable);
+
+  template<class Data>
+  bool sendData(uint32_t id, const Data& data, std::false_type isTriviallyCopyable);
+
+  static void deserializeHeader(const uint8_t* header, int32_t* id, uint16_t* flags, uint16_t* ackId);
+
+  void encodeDelta(Frame* frame);
+
+  // Backlogs the serialized "frame" and queues it if the window has room, fails if the backlog is full.
+  void sendAcknowledged(Frame* frame, std::chrono::steady_clock::duration timeout, const AckCallback& callback);
+
+  // Completes the pending ack and moves backlogged frames into the window.
+  void completeAck(uint16_t ackId, bool acknowledged);
+
+  // Moves backlogged messages into the window while there is room and assigns their ack ids. Those whose timeout
+  // passed in the backlog are failed, their callbacks go to "failed". ackMutex_ must be held.
+  void fillAckWindow(std::chrono::steady_clock::time_point now, Transmissions* transmissions,
+      std::vector<AckCallback>* failed);
+
+  // Retransmits or fails acks whose timeout passed, returns the time of the next timeout.
+  std::chrono::steady_clock::time_point expireAcks();
+
+  // Prepares the next transmission of a pending ack, ackMutex_ must be held.
+  void transmitAck(uint16_t ackId, PendingAck* pendingAck, std::chrono::steady_clock::time_point now,
+      Transmissions* transmissions);
+
+  // (Re)inserts the pending ack into ackTimeouts_ at its next retransmission or deadline, ackMutex_ must be held.
+  void scheduleAck(uint16_t ackId, PendingAck* pendingAck);
+
+  // Queues frames prepared by transmitAck(). Messages that do not fit go back to the front of the backlog and are
+  // sent again once the window is refilled.
+  void pushTransmissions(Transmissions* transmissions);
+
+  // Starts the round trip and retransmission timers of acknowledged frames the datalink accepted.
+  void markAcksSent(const uint16_t* ackIds, size_t nAckIds, std::chrono::steady_clock::time_point now);
+
+  // Updates the round trip estimate with a new measurement, ackMutex_ must be held.
+  void updateRtt(std::chrono::steady_clock::duration rtt);
+  void handleFrame(const uint8_t* frame, size_t size, std::chrono::steady_clock::time_point timestamp);
+
+  // Returns nullptr if "id" has no subscription.
+  SubscriptionPtr findSubscription(uint32_t id);
 
-  static void deserialize(const ByteVector& frame, int32_t* id, uint16_t* flags, uint16_t* ackId, ByteVector* datagram);
+  // Hands the datagram over to the executor of "subscription", takes its buffer.
+  void postDatagram(const SubscriptionPtr& subscription, Datagram* datagram);
 };
 
 typedef std::shared_ptr<asctec_comm::Transport> TransportPtr;
@@ -29,6 +29,13 @@ namespace asctec_comm
 typedef std::vector<uint8_t> ByteVector;
 std::ostream& operator <<(std::ostream& stream, const ByteVector& v);
 
+/// Pointer and length of a contiguous block of bytes, used to pass a frame as a list of segments.
+struct ConstBuffer
+{
+  const uint8_t* data;
+  size_t size;
+};
+
 std::string flightModeFlagsToString(int32_t flightMode);
 std::string safetyPilotFlagsToString(uint8_t safetyPilotFlags);
 std::string vehicleTypeToString(const asctec_uav_msgs::VehicleType& type);
@@ -66,6 +66,11 @@ public:
     return ::read(fd_, data, size);
   }
 
+  virtual int getFileDescriptor() const
+  {
+    return fd_;
+  }
+
 private:
   bool getBestBaudrateConstant(const int baudrate, int* baudConst);
 
@@ -14,7 +14,19 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ASCTEC_COBS_SSE2
+#include <immintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
 #include <asctec_comm/cobs.h>
+#include <asctec_comm/crc16.h>
 
 namespace asctec_comm
 {
@@ -22,26 +34,44 @@ namespace cobs
 {
 
 Encoder::Encoder()
+    : out_(nullptr), capacity_(0), size_(0), ownsBuffer_(true), overflow_(false), code_(StuffingCode::DiffZero),
+      codeIndex_(0)
 {
   reset();
 }
 
-constexpr size_t Encoder::getMaxEncodedSize(size_t inSize)
+Encoder::Encoder(uint8_t* buffer, size_t capacity)
+    : out_(buffer), capacity_(buffer ? capacity : 0), size_(0), ownsBuffer_(false), overflow_(false),
+      code_(StuffingCode::DiffZero), codeIndex_(0)
 {
-  return ((inSize) + (inSize) / 208 + 1);
+  reset();
 }
 
 Encoder& Encoder::reset()
 {
-  out_.clear();
+  size_ = 0;
+  overflow_ = false;
 
   code_ = StuffingCode::DiffZero;
-  out_.push_back(code_);
+  put(code_);
   codeIndex_ = 0;
 
   return *this;
 }
 
+bool Encoder::grow()
+{
+  if(!ownsBuffer_)
+  {
+    return false;
+  }
+
+  storage_.resize(storage_.empty() ? 64 : storage_.size() * 2);
+  out_ = storage_.data();
+  capacity_ = storage_.size();
+  return true;
+}
+
 void Encoder::feed(uint8_t c)
 {
   if(c == 0) // If it's a zero, do one of these operations
@@ -82,7 +112,7 @@ void Encoder::feed(uint8_t c)
       code_ = StuffingCode::DiffZero;
     }
 
-    out_.push_back(c);
+    put(c);
 
     if(++code_ == StuffingCode::Diff)
     {
@@ -92,5 +122,299 @@ void Encoder::feed(uint8_t c)
   }
 }
 
+void Encoder::feed(const uint8_t* data, size_t size)
+{
+  feed(data, size, nullptr);
+}
+
+void Encoder::feed(const uint8_t* data, size_t size, uint16_t* crc)
+{
+  const uint8_t* end = data + size;
+
+  // single bytes are added directly, only literal runs are worth the dispatched bulk routine
+  const uint16_t* crcTable = crc ? crc::getTable() : nullptr;
+
+  while(data < end)
+  {
+    // Zeros and the transition out of ZPE/ZRE state go through the state machine,
+    // literal runs are copied in bulk up to the end of the current block.
+    if(*data == 0 || code_ > StuffingCode::DiffZeroMax)
+    {
+      if(crc)
+      {
+        *crc = (*crc >> 8) ^ crcTable[(*crc ^ *data) & 0xff];
+      }
+      feed(*data++);
+      continue;
+    }
+
+    const size_t maxRun = std::min<size_t>(StuffingCode::Diff - code_, end - data);
+    const size_t run = findZero(data, maxRun);
+
+    if(crc)
+    {
+      *crc = crc16(data, data + run, *crc);
+    }
+    put(data, run);
+    data += run;
+    code_ += run;
+
+    if(code_ == StuffingCode::Diff)
+    {
+      finalizeBlock(code_);
+      code_ = StuffingCode::DiffZero;
+    }
+  }
+}
+
+#ifdef ASCTEC_COBS_SSE2
+static inline size_t countTrailingZeros(uint32_t x)
+{
+#ifdef _MSC_VER
+  unsigned long index;
+  _BitScanForward(&index, x);
+  return index;
+#else
+  return __builtin_ctz(x);
+#endif
+}
+#endif
+
+size_t findZero(const uint8_t* data, size_t size)
+{
+  size_t i = 0;
+
+#ifdef __AVX2__
+  const __m256i zero32 = _mm256_setzero_si256();
+  for(; i + 32 <= size; i += 32)
+  {
+    const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+    const uint32_t mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, zero32));
+    if(mask)
+    {
+      return i + countTrailingZeros(mask);
+    }
+  }
+#endif
+
+#ifdef ASCTEC_COBS_SSE2
+  const __m128i zero16 = _mm_setzero_si128();
+  for(; i + 16 <= size; i += 16)
+  {
+    const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+    const uint32_t mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, zero16));
+    if(mask)
+    {
+      return i + countTrailingZeros(mask);
+    }
+  }
+#endif
+
+  for(; i < size; ++i)
+  {
+    if(data[i] == 0)
+    {
+      return i;
+    }
+  }
+
+  return size;
+}
+
+StreamDecoder::StreamDecoder(uint8_t* buffer, size_t capacity)
+    : out_(buffer), capacity_(buffer ? capacity : 0)
+{
+  reset();
+}
+
+StreamDecoder& StreamDecoder::reset()
+{
+  size_ = 0;
+  literals_ = 0;
+  zeros_ = 0;
+  crcPos_ = 0;
+  crc_ = 0xffff;
+  empty_ = true;
+  overflow_ = false;
+  invalidCode_ = false;
+
+  return *this;
+}
+
+void StreamDecoder::feed(const uint8_t* data, size_t size)
+{
+  const uint8_t* end = data + size;
+
+  if(data < end)
+  {
+    empty_ = false;
+  }
+
+  while(data < end)
+  {
+    if(literals_ == 0)
+    {
+      decodeCode(*data++);
+      continue;
+    }
+
+    const size_t run = std::min<size_t>(literals_, end - data);
+    put(data, run);
+    data += run;
+    literals_ -= run;
+  }
+
+  updateCrc();
+}
+
+size_t StreamDecoder::finish()
+{
+  // The encoder always appends one zero which is not part of the data.
+  if(zeros_ > 0)
+  {
+    putZeros(zeros_ - 1);
+  }
+  else if(size_ > 0)
+  {
+    --size_;
+
+    // only happens for malformed frames, start over
+    crcPos_ = 0;
+    crc_ = 0xffff;
+  }
+  zeros_ = 0;
+
+  updateCrc();
+
+  return overflow_ ? 0 : size_;
+}
+
+void StreamDecoder::updateCrc()
+{
+  // The last two bytes decoded so far may be the checksum of the frame, so the crc lags behind by two bytes.
+  if(size_ > crcPos_ + 2)
+  {
+    crc_ = crc16(out_ + crcPos_, out_ + size_ - 2, crc_);
+    crcPos_ = size_ - 2;
+  }
+}
+
+void StreamDecoder::decodeCode(uint8_t c)
+{
+  // Zeros of the previous block are only emitted once we know it was not the last one.
+  putZeros(zeros_);
+
+  if(c == StuffingCode::Unused)
+  {
+    invalidCode_ = true;
+  }
+
+  splitCode(c, &literals_, &zeros_);
+}
+
+void StreamDecoder::put(const uint8_t* data, size_t size)
+{
+  if(ASCTEC_UNLIKELY(capacity_ - size_ < size))
+  {
+    overflow_ = true;
+    size = capacity_ - size_;
+  }
+  memcpy(out_ + size_, data, size);
+  size_ += size;
+}
+
+void StreamDecoder::putZeros(size_t size)
+{
+  if(ASCTEC_UNLIKELY(capacity_ - size_ < size))
+  {
+    overflow_ = true;
+    size = capacity_ - size_;
+  }
+  memset(out_ + size_, 0, size);
+  size_ += size;
+}
+
+DecodeStatus decode(const uint8_t* in, size_t size, uint8_t* out, size_t outCapacity, size_t* outSize)
+{
+  const uint8_t* end = in + size;
+  size_t pos = 0;
+  size_t zeros = 0;
+  DecodeStatus status = DecodeStatus::Ok;
+
+  while(in < end)
+  {
+    const uint8_t c = *in++;
+    if(c == StuffingCode::Unused)
+    {
+      status = DecodeStatus::InvalidCode;
+      break;
+    }
+
+    // Zeros of the previous block are only written once we know it was not the last one.
+    if(outCapacity - pos < zeros)
+    {
+      status = DecodeStatus::Overflow;
+      break;
+    }
+    memset(out + pos, 0, zeros);
+    pos += zeros;
+
+    size_t literals;
+    splitCode(c, &literals, &zeros);
+
+    if(static_cast<size_t>(end - in) < literals)
+    {
+      status = DecodeStatus::Truncated;
+      literals = end - in;
+    }
+    if(outCapacity - pos < literals)
+    {
+      status = DecodeStatus::Overflow;
+      literals = outCapacity - pos;
+    }
+
+    memcpy(out + pos, in, literals);
+    pos += literals;
+    in += literals;
+
+    if(status != DecodeStatus::Ok)
+    {
+      break;
+    }
+  }
+
+  // The encoder always appends one zero which is not part of the data.
+  if(status == DecodeStatus::Ok && zeros > 0)
+  {
+    if(outCapacity - pos < zeros - 1)
+    {
+      status = DecodeStatus::Overflow;
+    }
+    else
+    {
+      memset(out + pos, 0, zeros - 1);
+      pos += zeros - 1;
+    }
+  }
+  else if(status == DecodeStatus::Ok && pos > 0)
+  {
+    --pos;
+  }
+
+  if(outSize)
+  {
+    *outSize = pos;
+  }
+
+  return status;
+}
+
+size_t encode(const uint8_t* in, size_t size, uint8_t* out, size_t outCapacity)
+{
+  Encoder encoder(out, outCapacity);
+  encoder.feed(in, size);
+  return encoder.finish();
+}
+
 } // end namespace cobs
 } // end namespace asctec_comm
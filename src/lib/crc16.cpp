@@ -0,0 +1,208 @@
+/*
+ * Copyright (C) 2017 Intel Deutschland GmbH, Germany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <asctec_comm/crc16.h>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define ASCTEC_CRC_CLMUL
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define ASCTEC_TARGET_CLMUL
+#else
+#include <cpuid.h>
+#define ASCTEC_TARGET_CLMUL __attribute__((target("pclmul,sse2")))
+#endif
+#endif
+
+namespace asctec_comm
+{
+namespace crc
+{
+
+namespace
+{
+
+constexpr uint16_t kPolynomial = 0x8408;  // x^16 + x^12 + x^5 + 1, reflected
+
+// Short inputs are not worth the setup of the faster implementations.
+constexpr size_t kMinClmulSize = 64;
+
+struct Tables
+{
+  Tables()
+  {
+    for(int n = 0; n < 256; ++n)
+    {
+      uint16_t crc = n;
+      for(int bit = 0; bit < 8; ++bit)
+      {
+        crc = (crc & 1) ? (crc >> 1) ^ kPolynomial : crc >> 1;
+      }
+      t[0][n] = crc;
+    }
+
+    for(int k = 1; k < 8; ++k)
+    {
+      for(int n = 0; n < 256; ++n)
+      {
+        t[k][n] = (t[k - 1][n] >> 8) ^ t[0][t[k - 1][n] & 0xff];
+      }
+    }
+  }
+
+  uint16_t t[8][256];
+};
+
+const Tables& getTables()
+{
+  static const Tables tables;
+  return tables;
+}
+
+typedef uint16_t (*Function)(const uint8_t*, const uint8_t*, uint16_t);
+
+Implementation selectImplementation()
+{
+  return isClmulSupported() ? Implementation::Clmul : Implementation::SlicingBy8;
+}
+
+Function getFunction(Implementation implementation)
+{
+  switch(implementation)
+  {
+    case Implementation::Clmul:
+      return &clmul;
+    case Implementation::SlicingBy8:
+      return &slicingBy8;
+    default:
+      return &table;
+  }
+}
+
+} // end anonymous namespace
+
+uint16_t table(const uint8_t* first, const uint8_t* last, uint16_t crc)
+{
+  const Tables& tables = getTables();
+
+  for(const uint8_t* it = first; it < last; ++it)
+  {
+    crc = (crc >> 8) ^ tables.t[0][(crc ^ *it) & 0xff];
+  }
+
+  return crc;
+}
+
+const uint16_t* getTable()
+{
+  return getTables().t[0];
+}
+
+uint16_t slicingBy8(const uint8_t* first, const uint8_t* last, uint16_t crc)
+{
+  const Tables& tables = getTables();
+  const uint8_t* it = first;
+
+  for(; last - it >= 8; it += 8)
+  {
+    crc ^= it[0] | (it[1] << 8);
+    crc = tables.t[7][crc & 0xff] ^ tables.t[6][crc >> 8] ^ tables.t[5][it[2]] ^ tables.t[4][it[3]]
+        ^ tables.t[3][it[4]] ^ tables.t[2][it[5]] ^ tables.t[1][it[6]] ^ tables.t[0][it[7]];
+  }
+
+  return table(it, last, crc);
+}
+
+#ifdef ASCTEC_CRC_CLMUL
+
+ASCTEC_TARGET_CLMUL
+uint16_t clmul(const uint8_t* first, const uint8_t* last, uint16_t crc)
+{
+  if(last - first < static_cast<ptrdiff_t>(kMinClmulSize))
+  {
+    return slicingBy8(first, last, crc);
+  }
+
+  // Folding constants in the reflected domain: (x^191 mod P) and (x^127 mod P), bit-reversed and shifted left by 48.
+  // One power less than the fold distance compensates the one bit offset of reflected carry-less products.
+  const __m128i constants = _mm_set_epi64x(0x7eea000000000000LL, static_cast<long long>(0xa95d000000000000ULL));
+
+  // The initial crc is the same as xor-ing it into the first two bytes of the data.
+  const uint8_t* it = first;
+  __m128i acc = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(it)), _mm_cvtsi32_si128(crc));
+  it += 16;
+
+  for(; last - it >= 16; it += 16)
+  {
+    const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(it));
+    acc = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(acc, constants, 0x00),
+        _mm_clmulepi64_si128(acc, constants, 0x11)), block);
+  }
+
+  // The accumulator is congruent to the data processed so far, so its crc (starting from zero) is the result.
+  uint8_t folded[16];
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(folded), acc);
+  crc = slicingBy8(folded, folded + 16, 0);
+
+  return slicingBy8(it, last, crc);
+}
+
+bool isClmulSupported()
+{
+#ifdef _MSC_VER
+  int info[4];
+  __cpuid(info, 1);
+  return (info[2] & (1 << 1)) != 0;
+#else
+  unsigned int eax, ebx, ecx, edx;
+  if(!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+  {
+    return false;
+  }
+  return (ecx & bit_PCLMUL) != 0;
+#endif
+}
+
+#else
+
+uint16_t clmul(const uint8_t* first, const uint8_t* last, uint16_t crc)
+{
+  return slicingBy8(first, last, crc);
+}
+
+bool isClmulSupported()
+{
+  return false;
+}
+
+#endif
+
+Implementation getImplementation()
+{
+  static const Implementation implementation = selectImplementation();
+  return implementation;
+}
+
+} // end namespace crc
+
+uint16_t crc16(const uint8_t* first, const uint8_t* last, uint16_t crc)
+{
+  static const crc::Function function = crc::getFunction(crc::getImplementation());
+  return function(first, last, crc);
+}
+
+} // end namespace asctec_comm
@@ -15,18 +15,30 @@
  */
 
 #include <algorithm>
+#include <cstring>
 #include <deque>
 
 #include <asctec_comm/datalink.h>
 #include <asctec_comm/cobs.h>
+#include <asctec_comm/crc16.h>
 #include <asctec_comm/macros.h>
 
 namespace asctec_comm
 {
 
-DataLink::DataLink(RawBufferPtr rawBuffer)
-    : sendSequence_(0), receiveSequence_(0), nFramesSent_(0), nFramesSentSkipped_(0), nFramesReceived_(0), nFramesReceivedMissed_(),
-      nFramesReceivedCrcError_(0), receiveProcessingBufferPos_(0)
+constexpr size_t DataLink::kFramePoolSize_;
+
+DataLink::DataLink(RawBufferPtr rawBuffer, size_t maxFrameSize, size_t fecParitySize)
+    : sendSequence_(0), receiveSequence_(0), receiveSequenceValid_(false), nFramesSent_(0), nFramesSentSkipped_(0),
+      nBytesSent_(0), nPartialWrites_(0), nFramesReceived_(0), nBytesReceived_(0), nFramesReceivedCrcError_(0),
+      nFramesReceivedRepaired_(0), nBytesRepaired_(0), nFramesReceivedMalformed_(0), nFramesReceivedOverflow_(0),
+      nSequenceGaps_(0), nFramesLost_(0), maxFrameSize_(maxFrameSize),
+      fec_(fecParitySize > 0 ? new fec::ReedSolomon(fecParitySize) : nullptr),
+      codedFrameSize_(fec_ ? fec_->getEncodedSize(maxFrameSize + 4) : maxFrameSize + 4),
+      sendBuffer_(cobs::Encoder::getMaxEncodedSize(codedFrameSize_) + 1), sendFecBuffer_(fec_ ? maxFrameSize + 4 : 0),
+      receiveBuffer_(sendBuffer_.size()), receiveFrameBuffer_(codedFrameSize_),
+      receiveDecoder_(receiveFrameBuffer_.data(), receiveFrameBuffer_.size()), receiveResync_(false),
+      framePool_(std::make_shared<FramePool>(maxFrameSize, kFramePoolSize_))
 {
   if(!rawBuffer)
   {
@@ -35,99 +47,415 @@ DataLink::DataLink(RawBufferPtr rawBuffer)
   }
 
   rawBuffer_ = rawBuffer;
+  sendPending_.reserve(sendBuffer_.size());
 }
 
 DataLink::~DataLink()
 {
 }
 
-void DataLink::sendFrame(const ByteVector& frame)
+bool DataLink::sendFrame(const ByteVector& frame)
 {
-  constexpr uint8_t separator = 0;
+  const ConstBuffer segment = { frame.data(), frame.size() };
+  return sendFrame(&segment, 1);
+}
+
+bool DataLink::sendFrame(const ConstBuffer* segments, size_t nSegments)
+{
+  return sendFrames(segments, nSegments, 1) == 1;
+}
+
+size_t DataLink::sendFrames(const ConstBuffer* segments, size_t nSegmentsPerFrame, size_t nFrames)
+{
+  std::lock_guard<std::mutex> lock(sendMutex_);
+
+  // frames must not overtake the rest of an earlier one
+  if(!flushPending())
+  {
+    return 0;
+  }
+
+  size_t pos = 0;
+
+  for(size_t i = 0; i < nFrames; ++i)
+  {
+    const ConstBuffer* frameSegments = segments + i * nSegmentsPerFrame;
+    size_t size = 0;
+
+    if(getFrameSize(frameSegments, nSegmentsPerFrame) > maxFrameSize_)
+    {
+      ASCTEC_ERROR_STREAM("frame exceeds the maximum frame size of " << maxFrameSize_ << ", skipping");
+      increment(&nFramesSentSkipped_);
+      continue;
+    }
+
+    // write out what we have if the worst-case encoding of the frame would not fit behind it
+    if(sendBuffer_.size() - pos < getMaxEncodedFrameSize(getFrameSize(frameSegments, nSegmentsPerFrame)))
+    {
+      write(sendBuffer_.data(), pos);
+      pos = 0;
+
+      if(!sendPending_.empty())
+      {
+        return i;
+      }
+    }
 
-  uint16_t crc = 0xffff;
-  crc = trinity_msgs::crc16(frame.cbegin(), frame.cend(), crc);
+    if(fec_)
+    {
+      size = encodeFecFrame(frameSegments, nSegmentsPerFrame, sendBuffer_.data() + pos, sendBuffer_.size() - pos);
+    }
+    else
+    {
+      // leave space for the separator
+      cobs::Encoder encoder(sendBuffer_.data() + pos, sendBuffer_.size() - pos - 1);
 
-  cobs::Encoder encoder;
-  encoder << frame;
-  encoder << sendSequence_;
-  encoder << trinity_msgs::crc16((uint8_t*)&sendSequence_, (uint8_t*)&sendSequence_ + 2, crc);
+      // checksum is computed in the same pass as the encoding
+      uint16_t crc = 0xffff;
+      encoder.feed(frameSegments, nSegmentsPerFrame, &crc);
+      size = finishFrame(&encoder, crc, sendBuffer_.data() + pos);
+    }
 
-  ByteVector buffer = encoder.getResult();
-  buffer.push_back(separator);
+    if(size == 0)
+    {
+      ASCTEC_ERROR_STREAM("frame does not fit into the send buffer, skipping");
+      increment(&nFramesSentSkipped_);
+      continue;
+    }
+
+    pos += size;
+  }
 
-  rawBuffer_->writeBuffer(buffer.data(), buffer.size());
+  if(pos > 0)
+  {
+    write(sendBuffer_.data(), pos);
+  }
+
+  return nFrames;
+}
+
+size_t DataLink::getMaxFrameSize() const
+{
+  return maxFrameSize_;
+}
+
+bool DataLink::flush()
+{
+  std::lock_guard<std::mutex> lock(sendMutex_);
+  return flushPending();
+}
+
+size_t DataLink::getMaxEncodedFrameSize(size_t frameSize) const
+{
+  // sequence number and checksum, then parity, then COBS overhead and the separator
+  const size_t codedSize = fec_ ? fec_->getEncodedSize(frameSize + 4) : frameSize + 4;
+  return cobs::Encoder::getMaxEncodedSize(codedSize) + 1;
+}
+
+size_t DataLink::finishFrame(cobs::Encoder* encoder, uint16_t crc, uint8_t* buffer)
+{
+  encoder->feed(reinterpret_cast<const uint8_t*>(&sendSequence_), sizeof(sendSequence_), &crc);
+  *encoder << crc;
+
+  return terminateFrame(encoder, buffer);
+}
+
+size_t DataLink::encodeFecFrame(const ConstBuffer* segments, size_t nSegments, uint8_t* buffer, size_t capacity)
+{
+  uint8_t* frame = sendFecBuffer_.data();
+  size_t size = 0;
+  for(size_t i = 0; i < nSegments; ++i)
+  {
+    memcpy(frame + size, segments[i].data, segments[i].size);
+    size += segments[i].size;
+  }
+
+  memcpy(frame + size, &sendSequence_, sizeof(sendSequence_));
+  size += sizeof(sendSequence_);
+  const uint16_t crc = crc16(frame, frame + size);
+  memcpy(frame + size, &crc, sizeof(crc));
+  size += sizeof(crc);
+
+  if(capacity < 1)
+  {
+    return 0;
+  }
+
+  // leave space for the separator
+  cobs::Encoder encoder(buffer, capacity - 1);
+
+  // each block is followed by its parity
+  const size_t blockSize = fec::ReedSolomon::kMaxBlockSize - fec_->getParitySize();
+  uint8_t parity[fec::ReedSolomon::kMaxBlockSize];
+  for(size_t pos = 0; pos < size; pos += blockSize)
+  {
+    const size_t n = std::min(blockSize, size - pos);
+    fec_->encodeBlock(frame + pos, n, parity);
+    encoder.feed(frame + pos, n);
+    encoder.feed(parity, fec_->getParitySize());
+  }
+
+  return terminateFrame(&encoder, buffer);
+}
+
+size_t DataLink::terminateFrame(cobs::Encoder* encoder, uint8_t* buffer)
+{
+  constexpr uint8_t separator = 0;
+
+  const size_t size = encoder->finish();
+  if(size == 0)
+  {
+    return 0;
+  }
+
+  buffer[size] = separator;
 
   ++sendSequence_;
+  increment(&nFramesSent_);
+
+  return size + 1;
 }
 
-void DataLink::pollFramesUnBuffered(std::vector<ByteVector>* frames)
+void DataLink::pollFramesUnBuffered(std::vector<ByteVector>* frames,
+    std::vector<std::chrono::steady_clock::time_point>* timestamps)
 {
   if(!frames)
   {
     ASCTEC_ERROR_STREAM("hey, don't pass nullptrs!!");
     return;
   }
+
+  for(auto& frame : *frames)
+  {
+    framePool_->release(&frame);
+  }
   frames->clear();
 
-  int bytesRead = rawBuffer_->readBuffer(receiveBuffer_, kReceiveBufferSize_);
+  if(timestamps)
+  {
+    timestamps->clear();
+  }
+
+  // captures no more than two pointers, so the std::function does not allocate
+  struct Output
+  {
+    std::vector<ByteVector>* frames;
+    std::vector<std::chrono::steady_clock::time_point>* timestamps;
+  } output = { frames, timestamps };
+
+  pollFrames([this, &output](const uint8_t* data, size_t size, std::chrono::steady_clock::time_point timestamp)
+  {
+    output.frames->emplace_back();
+    framePool_->acquire(&output.frames->back());
+    output.frames->back().assign(data, data + size);
+
+    if(output.timestamps)
+    {
+      output.timestamps->push_back(timestamp);
+    }
+  });
+}
+
+void DataLink::pollFrames(const FrameVisitor& visitor)
+{
+  int bytesRead = rawBuffer_->readBuffer(receiveBuffer_.data(), receiveBuffer_.size());
 
   if(bytesRead < 1)
   {
     return;
   }
 
-  int receiveBufferPos = 0;
+  const std::chrono::steady_clock::time_point timestamp = std::chrono::steady_clock::now();
+  increment(&nBytesReceived_, bytesRead);
 
-  for(; receiveBufferPos < bytesRead; ++receiveBufferPos)
+  const uint8_t* data = receiveBuffer_.data();
+  const uint8_t* end = receiveBuffer_.data() + bytesRead;
+
+  while(data < end)
   {
-    const uint8_t data = receiveBuffer_[receiveBufferPos];
-    if(data != 0)
+    // Decode everything up to the next separator, a frame is complete as soon as the separator is seen.
+    const size_t size = cobs::findZero(data, end - data);
+
+    if(!receiveResync_)
     {
-      receiveProcessingBuffer_[receiveProcessingBufferPos_] = data;
-      ++receiveProcessingBufferPos_;
+      receiveDecoder_.feed(data, size);
 
-      if(receiveProcessingBufferPos_ >= kReceiveBufferSize_)
+      if(receiveDecoder_.overflow())
       {
-        receiveProcessingBufferPos_ = 0;
-        ASCTEC_WARN_STREAM("receive buffer overflow");
-        return;
+        // Only this frame is lost, the following ones start after the next separator.
+        ASCTEC_WARN_STREAM("receive buffer overflow, dropping frame");
+        increment(&nFramesReceivedOverflow_);
+        receiveDecoder_.reset();
+        receiveResync_ = true;
       }
     }
-    else
+
+    data += size;
+
+    if(data == end)
     {
-      if(receiveProcessingBufferPos_ == 0)
-      {
-        continue;
-      }
+      break;
+    }
 
-      ByteVector decodedStream = cobs::decode(&receiveProcessingBuffer_[0],
-          &receiveProcessingBuffer_[receiveProcessingBufferPos_]);
-      receiveProcessingBufferPos_ = 0;
+    ++data;  // skip separator
 
-      if(decodedStream.size() >= 4)
-      {
-        // Decompose into seq, data, crc, and check
-        const uint16_t seq = *reinterpret_cast<const uint16_t*>(&(*(decodedStream.cend() - 4)));
-        const uint16_t crc = *reinterpret_cast<const uint16_t*>(&(*(decodedStream.cend() - 2)));
-        const uint16_t crcMsg = trinity_msgs::crc16(decodedStream.cbegin(), decodedStream.cend() - 2, 0xffff);
-
-        if(crc == crcMsg)
-        {
-          frames->push_back(ByteVector(decodedStream.cbegin(), decodedStream.cend() - 4));
-        }
-        else
-        {
-          ASCTEC_ERROR_STREAM("crc failed. crc=" << crc << " crc computed=" << crcMsg);
-          ++nFramesReceivedCrcError_;
-        }
-      }
-      else
-      {
-        ASCTEC_ERROR_STREAM("Encoded message size < 4, this should not happen");
-      }
+    if(receiveResync_)
+    {
+      receiveResync_ = false;
+      continue;
+    }
+
+    if(receiveDecoder_.empty())
+    {
+      continue;
+    }
+
+    processReceivedFrame(visitor, timestamp);
+    receiveDecoder_.reset();
+  }
+}
+
+LinkStatistics DataLink::getStatistics() const
+{
+  LinkStatistics statistics;
+  statistics.framesSent = nFramesSent_.load(std::memory_order_relaxed);
+  statistics.framesSentSkipped = nFramesSentSkipped_.load(std::memory_order_relaxed);
+  statistics.bytesSent = nBytesSent_.load(std::memory_order_relaxed);
+  statistics.partialWrites = nPartialWrites_.load(std::memory_order_relaxed);
+  statistics.framesReceived = nFramesReceived_.load(std::memory_order_relaxed);
+  statistics.bytesReceived = nBytesReceived_.load(std::memory_order_relaxed);
+  statistics.framesReceivedCrcError = nFramesReceivedCrcError_.load(std::memory_order_relaxed);
+  statistics.framesReceivedRepaired = nFramesReceivedRepaired_.load(std::memory_order_relaxed);
+  statistics.bytesRepaired = nBytesRepaired_.load(std::memory_order_relaxed);
+  statistics.framesReceivedMalformed = nFramesReceivedMalformed_.load(std::memory_order_relaxed);
+  statistics.framesReceivedOverflow = nFramesReceivedOverflow_.load(std::memory_order_relaxed);
+  statistics.sequenceGaps = nSequenceGaps_.load(std::memory_order_relaxed);
+  statistics.framesLost = nFramesLost_.load(std::memory_order_relaxed);
+  return statistics;
+}
+
+FramePoolPtr DataLink::getFramePool() const
+{
+  return framePool_;
+}
+
+int DataLink::getFileDescriptor() const
+{
+  return rawBuffer_->getFileDescriptor();
+}
+
+void DataLink::processReceivedFrame(const FrameVisitor& visitor, std::chrono::steady_clock::time_point timestamp)
+{
+  size_t size = receiveDecoder_.finish();
+  const uint8_t* decoded = receiveDecoder_.data();
+  const cobs::DecodeStatus status = receiveDecoder_.getStatus();
+
+  // a zero run flushed by finish() can still exceed the receive capacity, that is an oversized frame as well
+  if(status == cobs::DecodeStatus::Overflow)
+  {
+    ASCTEC_WARN_STREAM("receive buffer overflow, dropping frame");
+    increment(&nFramesReceivedOverflow_);
+    return;
+  }
+
+  if(status != cobs::DecodeStatus::Ok)
+  {
+    ASCTEC_WARN_STREAM("malformed frame, decoder status " << static_cast<int>(status));
+    increment(&nFramesReceivedMalformed_);
+    return;
+  }
+
+  if(fec_)
+  {
+    // repairs and strips the parity in place, the checksum is computed afterwards
+    size_t nRepaired = 0;
+    if(!fec_->decode(receiveFrameBuffer_.data(), size, &size, &nRepaired))
+    {
+      ASCTEC_ERROR_STREAM("frame has too many errors to repair");
+      increment(&nFramesReceivedCrcError_);
+      return;
     }
+
+    if(nRepaired > 0)
+    {
+      increment(&nFramesReceivedRepaired_);
+      increment(&nBytesRepaired_, nRepaired);
+    }
+  }
+
+  if(size < 4)
+  {
+    ASCTEC_ERROR_STREAM("Encoded message size < 4, this should not happen");
+    increment(&nFramesReceivedMalformed_);
+    return;
   }
+
+  // Decompose into seq, data, crc, and check
+  uint16_t seq, crc;
+  memcpy(&seq, decoded + size - 4, sizeof(seq));
+  memcpy(&crc, decoded + size - 2, sizeof(crc));
+  const uint16_t crcMsg = fec_ ? crc16(decoded, decoded + size - 2) : receiveDecoder_.getCrc();
+
+  if(crc != crcMsg)
+  {
+    ASCTEC_ERROR_STREAM("crc failed. crc=" << crc << " crc computed=" << crcMsg);
+    increment(&nFramesReceivedCrcError_);
+    return;
+  }
+
+  increment(&nFramesReceived_);
+  checkSequence(seq);
+
+  visitor(decoded, size - 4, timestamp);
+}
+
+void DataLink::write(uint8_t* data, size_t size)
+{
+  // a nonblocking raw buffer may take only part of the data or nothing at all
+  const int result = rawBuffer_->writeBuffer(data, size);
+  const size_t written = result > 0 ? result : 0;
+  increment(&nBytesSent_, written);
+
+  if(written < size)
+  {
+    increment(&nPartialWrites_);
+    sendPending_.assign(data + written, data + size);
+  }
+}
+
+bool DataLink::flushPending()
+{
+  if(sendPending_.empty())
+  {
+    return true;
+  }
+
+  const int result = rawBuffer_->writeBuffer(sendPending_.data(), sendPending_.size());
+  if(result > 0)
+  {
+    increment(&nBytesSent_, result);
+    sendPending_.erase(sendPending_.begin(), sendPending_.begin() + result);
+  }
+
+  return sendPending_.empty();
+}
+
+void DataLink::checkSequence(uint16_t seq)
+{
+  if(receiveSequenceValid_)
+  {
+    // Frames in between were lost. A jump backwards means the other side restarted or frames were reordered, there is
+    // no way to tell how many got lost then.
+    const uint16_t gap = seq - receiveSequence_;
+    if(gap != 0 && gap < 0x8000)
+    {
+      increment(&nSequenceGaps_);
+      increment(&nFramesLost_, gap);
+    }
+  }
+
+  receiveSequence_ = seq + 1;
+  receiveSequenceValid_ = true;
 }
 
 }  //end namespace asctec_comm
@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2017 Intel Deutschland GmbH, Germany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <asctec_comm/delta.h>
+#include <asctec_comm/macros.h>
+
+namespace asctec_comm
+{
+namespace delta
+{
+
+Encoder::Encoder()
+    : nEnabled_(0)
+{
+}
+
+void Encoder::setKeyframeInterval(uint32_t id, unsigned int keyframeInterval)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto it = states_.find(id);
+  if(keyframeInterval == 0)
+  {
+    if(it != states_.end())
+    {
+      states_.erase(it);
+      --nEnabled_;
+    }
+    return;
+  }
+
+  if(it == states_.end())
+  {
+    it = states_.insert(std::make_pair(id, State())).first;
+    ++nEnabled_;
+  }
+
+  // the next message starts a new chain
+  it->second.keyframeInterval = keyframeInterval;
+  it->second.sinceKeyframe = keyframeInterval;
+}
+
+bool Encoder::isEnabled(uint32_t id) const
+{
+  if(nEnabled_ == 0)
+  {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  return states_.find(id) != states_.end();
+}
+
+bool Encoder::encode(uint32_t id, ByteVector* payload, uint16_t* flags, uint16_t* seq, bool keyframeOnly)
+{
+  if(nEnabled_ == 0)
+  {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto it = states_.find(id);
+  if(it == states_.end())
+  {
+    return false;
+  }
+
+  State& state = it->second;
+  *seq = state.seq++;
+
+  if(keyframeOnly || state.sinceKeyframe >= state.keyframeInterval || state.last.size() != payload->size())
+  {
+    state.last = *payload;
+    state.sinceKeyframe = 1;
+    *flags = FLAG_KEYFRAME;
+    return true;
+  }
+
+  // keep the plain payload as reference for the next message
+  uint8_t* data = payload->data();
+  uint8_t* last = state.last.data();
+  for(size_t i = 0; i < payload->size(); ++i)
+  {
+    const uint8_t c = data[i];
+    data[i] ^= last[i];
+    last[i] = c;
+  }
+
+  ++state.sinceKeyframe;
+  *flags = FLAG_DELTA;
+  return true;
+}
+
+bool Decoder::decode(uint32_t id, uint16_t flags, uint16_t seq, const uint8_t* payload, size_t size, ByteVector* out)
+{
+  State& state = states_[id];
+
+  if(flags & FLAG_KEYFRAME)
+  {
+    state.valid = true;
+    state.seq = seq;
+    state.last.assign(payload, payload + size);
+    out->assign(payload, payload + size);
+    return true;
+  }
+
+  if(!state.valid || seq != static_cast<uint16_t>(state.seq + 1) || size != state.last.size())
+  {
+    if(state.valid)
+    {
+      ASCTEC_WARN_STREAM("delta chain of id " << id << " broken, waiting for the next keyframe");
+    }
+    state.valid = false;
+    return false;
+  }
+
+  out->resize(size);
+  uint8_t* data = out->data();
+  uint8_t* last = state.last.data();
+  for(size_t i = 0; i < size; ++i)
+  {
+    last[i] ^= payload[i];
+    data[i] = last[i];
+  }
+
+  state.seq = seq;
+  return true;
+}
+
+}  // end namespace delta
+}  // end namespace asctec_comm
@@ -0,0 +1,369 @@
+/*
+ * Copyright (C) 2017 Intel Deutschland GmbH, Germany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cstring>
+
+#include <asctec_comm/fec.h>
+#include <asctec_comm/macros.h>
+
+namespace asctec_comm
+{
+namespace fec
+{
+
+namespace
+{
+
+constexpr unsigned int kPrimitivePolynomial = 0x11d;  // x^8 + x^4 + x^3 + x^2 + 1
+
+struct Galois
+{
+  uint8_t exp[512];  // doubled, so products of two logs need no modulo
+  uint8_t log[256];
+
+  Galois()
+  {
+    unsigned int x = 1;
+    for(int i = 0; i < 255; ++i)
+    {
+      exp[i] = x;
+      log[x] = i;
+      x <<= 1;
+      if(x & 0x100)
+      {
+        x ^= kPrimitivePolynomial;
+      }
+    }
+    for(int i = 255; i < 512; ++i)
+    {
+      exp[i] = exp[i - 255];
+    }
+    log[0] = 0;  // undefined, never used
+  }
+};
+
+const Galois& gf()
+{
+  static const Galois galois;
+  return galois;
+}
+
+inline uint8_t mul(uint8_t a, uint8_t b)
+{
+  if(a == 0 || b == 0)
+  {
+    return 0;
+  }
+  return gf().exp[gf().log[a] + gf().log[b]];
+}
+
+inline uint8_t div(uint8_t a, uint8_t b)
+{
+  if(a == 0)
+  {
+    return 0;
+  }
+  return gf().exp[gf().log[a] + 255 - gf().log[b]];
+}
+
+// alpha^power
+inline uint8_t pow(int power)
+{
+  power %= 255;
+  if(power < 0)
+  {
+    power += 255;
+  }
+  return gf().exp[power];
+}
+
+// p(x) with coefficients lowest degree first
+uint8_t evaluate(const uint8_t* p, size_t size, uint8_t x)
+{
+  uint8_t y = 0;
+  for(size_t i = size; i > 0; --i)
+  {
+    y = mul(y, x) ^ p[i - 1];
+  }
+  return y;
+}
+
+}  // namespace
+
+constexpr size_t ReedSolomon::kMaxBlockSize;
+
+ReedSolomon::ReedSolomon(size_t nParity)
+    : nParity_(std::max<size_t>(1, std::min<size_t>(nParity, kMaxBlockSize - 1)))
+{
+  if(nParity_ != nParity)
+  {
+    ASCTEC_ERROR_STREAM("number of parity bytes must be between 1 and 254, using " << nParity_);
+  }
+
+  // g(x) = (x - alpha^0) (x - alpha^1) ... (x - alpha^(nParity - 1))
+  memset(generator_, 0, sizeof(generator_));
+  generator_[0] = 1;
+  for(size_t i = 0; i < nParity_; ++i)
+  {
+    const uint8_t root = pow(i);
+    for(size_t j = i + 1; j > 0; --j)
+    {
+      generator_[j] ^= mul(generator_[j - 1], root);
+    }
+  }
+
+  for(size_t i = 0; i <= nParity_; ++i)
+  {
+    logGenerator_[i] = gf().log[generator_[i]];
+  }
+}
+
+size_t ReedSolomon::getParitySize() const
+{
+  return nParity_;
+}
+
+size_t ReedSolomon::getEncodedSize(size_t size) const
+{
+  const size_t blockData = kMaxBlockSize - nParity_;
+  return size + nParity_ * ((size + blockData - 1) / blockData);
+}
+
+size_t ReedSolomon::encode(const uint8_t* in, size_t size, uint8_t* out) const
+{
+  const size_t blockData = kMaxBlockSize - nParity_;
+  uint8_t* start = out;
+
+  while(size > 0)
+  {
+    const size_t n = std::min(size, blockData);
+    memmove(out, in, n);
+    encodeBlock(out, n, out + n);
+    in += n;
+    out += n + nParity_;
+    size -= n;
+  }
+
+  return out - start;
+}
+
+bool ReedSolomon::decode(uint8_t* data, size_t size, size_t* decodedSize, size_t* nCorrected) const
+{
+  const uint8_t* begin = data;
+  uint8_t* out = data;
+  size_t corrected = 0;
+
+  while(size > 0)
+  {
+    const size_t n = std::min(size, kMaxBlockSize);
+    if(n <= nParity_)
+    {
+      return false;
+    }
+
+    const int nErrors = decodeBlock(data, n);
+    if(nErrors < 0)
+    {
+      return false;
+    }
+    corrected += nErrors;
+
+    // drop the parity
+    memmove(out, data, n - nParity_);
+    out += n - nParity_;
+    data += n;
+    size -= n;
+  }
+
+  *decodedSize = out - begin;
+  if(nCorrected)
+  {
+    *nCorrected = corrected;
+  }
+  return true;
+}
+
+void ReedSolomon::encodeBlock(const uint8_t* data, size_t size, uint8_t* parity) const
+{
+  const Galois& g = gf();
+
+  // remainder of data(x) * x^nParity divided by g(x), computed with a shift register
+  uint8_t remainder[kMaxBlockSize];
+  memset(remainder, 0, nParity_);
+
+  for(size_t i = 0; i < size; ++i)
+  {
+    const uint8_t feedback = data[i] ^ remainder[0];
+    memmove(remainder, remainder + 1, nParity_ - 1);
+    remainder[nParity_ - 1] = 0;
+
+    if(feedback != 0)
+    {
+      // multiply in the log domain, the generator coefficients are never 0
+      const uint8_t* exp = g.exp + g.log[feedback];
+      for(size_t j = 0; j < nParity_; ++j)
+      {
+        remainder[j] ^= exp[logGenerator_[j + 1]];
+      }
+    }
+  }
+
+  memcpy(parity, remainder, nParity_);
+}
+
+int ReedSolomon::decodeBlock(uint8_t* block, size_t size) const
+{
+  // Intact blocks are the common case, checking the parity is much cheaper than computing the syndromes.
+  uint8_t parity[kMaxBlockSize];
+  encodeBlock(block, size - nParity_, parity);
+  if(memcmp(parity, block + size - nParity_, nParity_) == 0)
+  {
+    return 0;
+  }
+
+  // Byte i of the block is the coefficient of x^(size - 1 - i).
+  uint8_t syndromes[kMaxBlockSize];
+  bool hasErrors = false;
+  const Galois& g = gf();
+  for(size_t i = 0; i < nParity_; ++i)
+  {
+    // Horner's scheme with the multiplication by alpha^i in the log domain
+    uint8_t s = 0;
+    for(size_t j = 0; j < size; ++j)
+    {
+      s = (s == 0 ? 0 : g.exp[g.log[s] + i]) ^ block[j];
+    }
+    syndromes[i] = s;
+    hasErrors |= s != 0;
+  }
+
+  if(!hasErrors)
+  {
+    return 0;
+  }
+
+  // Berlekamp-Massey, error locator lambda(x) lowest degree first
+  uint8_t lambda[kMaxBlockSize + 1] = { 1 };
+  uint8_t previous[kMaxBlockSize + 1] = { 1 };
+  uint8_t tmp[kMaxBlockSize + 1];
+  size_t nErrors = 0;
+  size_t shift = 1;
+  uint8_t previousDiscrepancy = 1;
+
+  for(size_t n = 0; n < nParity_; ++n)
+  {
+    uint8_t discrepancy = syndromes[n];
+    for(size_t i = 1; i <= nErrors; ++i)
+    {
+      discrepancy ^= mul(lambda[i], syndromes[n - i]);
+    }
+
+    if(discrepancy == 0)
+    {
+      ++shift;
+      continue;
+    }
+
+    const uint8_t scale = div(discrepancy, previousDiscrepancy);
+
+    if(2 * nErrors <= n)
+    {
+      memcpy(tmp, lambda, nParity_ + 1);
+      for(size_t i = 0; i + shift <= nParity_; ++i)
+      {
+        lambda[i + shift] ^= mul(scale, previous[i]);
+      }
+      nErrors = n + 1 - nErrors;
+      memcpy(previous, tmp, nParity_ + 1);
+      previousDiscrepancy = discrepancy;
+      shift = 1;
+    }
+    else
+    {
+      for(size_t i = 0; i + shift <= nParity_; ++i)
+      {
+        lambda[i + shift] ^= mul(scale, previous[i]);
+      }
+      ++shift;
+    }
+  }
+
+  if(2 * nErrors > nParity_)
+  {
+    return -1;
+  }
+
+  // error evaluator omega(x) = syndromes(x) * lambda(x) mod x^nParity
+  uint8_t omega[kMaxBlockSize];
+  for(size_t i = 0; i < nParity_; ++i)
+  {
+    uint8_t o = 0;
+    for(size_t j = 0; j <= std::min(i, nErrors); ++j)
+    {
+      o ^= mul(lambda[j], syndromes[i - j]);
+    }
+    omega[i] = o;
+  }
+
+  // formal derivative of lambda, only the odd powers remain
+  uint8_t derivative[kMaxBlockSize + 1];
+  for(size_t i = 0; i < nErrors; ++i)
+  {
+    derivative[i] = (i % 2 == 0) ? lambda[i + 1] : 0;
+  }
+
+  // Chien search for the roots of lambda, Forney for the error values
+  size_t positions[kMaxBlockSize];
+  uint8_t values[kMaxBlockSize];
+  size_t nFound = 0;
+  for(size_t j = 0; j < size && nFound < nErrors; ++j)
+  {
+    const int power = size - 1 - j;
+    const uint8_t xInverse = pow(-power);
+
+    if(evaluate(lambda, nErrors + 1, xInverse) != 0)
+    {
+      continue;
+    }
+
+    const uint8_t denominator = evaluate(derivative, nErrors, xInverse);
+    if(denominator == 0)
+    {
+      return -1;
+    }
+
+    positions[nFound] = j;
+    values[nFound] = mul(pow(power), div(evaluate(omega, nParity_, xInverse), denominator));
+    ++nFound;
+  }
+
+  // the locator has roots outside the block, too many errors
+  if(nFound != nErrors)
+  {
+    return -1;
+  }
+
+  for(size_t i = 0; i < nFound; ++i)
+  {
+    block[positions[i]] ^= values[i];
+  }
+
+  return nFound;
+}
+
+} // end namespace fec
+} // end namespace asctec_comm
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2017 Intel Deutschland GmbH, Germany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <asctec_comm/frame_pool.h>
+
+namespace asctec_comm
+{
+
+FramePool::FramePool(size_t frameCapacity, size_t size)
+    : frameCapacity_(frameCapacity), size_(size)
+{
+  free_.reserve(size_);
+  for(size_t i = 0; i < size_; ++i)
+  {
+    free_.emplace_back();
+    free_.back().reserve(frameCapacity_);
+  }
+}
+
+void FramePool::acquire(ByteVector* frame)
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  if(!free_.empty())
+  {
+    frame->swap(free_.back());
+    free_.pop_back();
+    frame->clear();
+    return;
+  }
+
+  lock.unlock();
+
+  ByteVector buffer;
+  buffer.reserve(frameCapacity_);
+  frame->swap(buffer);
+}
+
+void FramePool::release(ByteVector* frame)
+{
+  ByteVector buffer;
+  buffer.swap(*frame);
+
+  if(buffer.capacity() < frameCapacity_)
+  {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  // free_ has space reserved for size_ buffers, so this does not allocate
+  if(free_.size() < size_)
+  {
+    free_.emplace_back();
+    free_.back().swap(buffer);
+  }
+}
+
+size_t FramePool::getFrameCapacity() const
+{
+  return frameCapacity_;
+}
+
+size_t FramePool::available() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return free_.size();
+}
+
+}  // end namespace asctec_comm
@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2017 Intel Deutschland GmbH, Germany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <asctec_comm/macros.h>
+#include <asctec_comm/reactor.h>
+
+#ifdef __linux__
+#include <errno.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+namespace asctec_comm
+{
+
+#ifdef __linux__
+
+Reactor::Reactor(int fd)
+    : fd_(fd), epollFd_(-1), eventFd_(-1)
+{
+  if(fd_ < 0)
+  {
+    return;
+  }
+
+  epollFd_ = epoll_create1(EPOLL_CLOEXEC);
+  eventFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if(epollFd_ < 0 || eventFd_ < 0)
+  {
+    ASCTEC_ERROR_STREAM("Error while setting up epoll: " << strerror(errno));
+    return;
+  }
+
+  epoll_event event = epoll_event();
+  event.events = EPOLLIN;
+  event.data.fd = fd_;
+  if(epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd_, &event) < 0)
+  {
+    ASCTEC_ERROR_STREAM("Error while adding fd " << fd_ << " to epoll: " << strerror(errno));
+    fd_ = -1;
+    return;
+  }
+
+  event.data.fd = eventFd_;
+  if(epoll_ctl(epollFd_, EPOLL_CTL_ADD, eventFd_, &event) < 0)
+  {
+    ASCTEC_ERROR_STREAM("Error while adding the eventfd to epoll: " << strerror(errno));
+    fd_ = -1;
+  }
+}
+
+Reactor::~Reactor()
+{
+  if(epollFd_ >= 0)
+  {
+    ::close(epollFd_);
+  }
+
+  if(eventFd_ >= 0)
+  {
+    ::close(eventFd_);
+  }
+}
+
+bool Reactor::isValid() const
+{
+  return fd_ >= 0 && epollFd_ >= 0 && eventFd_ >= 0;
+}
+
+bool Reactor::wait(const std::chrono::milliseconds& timeout)
+{
+  if(!isValid())
+  {
+    return false;
+  }
+
+  epoll_event events[2];
+  const int n = epoll_wait(epollFd_, events, 2, timeout.count());
+
+  bool readable = false;
+  for(int i = 0; i < n; ++i)
+  {
+    if(events[i].data.fd == eventFd_)
+    {
+      // reset the counter, the wakeup is consumed by this call
+      uint64_t value;
+      if(::read(eventFd_, &value, sizeof(value)) < 0 && errno != EAGAIN)
+      {
+        ASCTEC_ERROR_STREAM("Error while reading the eventfd: " << strerror(errno));
+      }
+      return false;
+    }
+
+    readable = true;
+  }
+
+  return readable;
+}
+
+void Reactor::wakeup()
+{
+  if(eventFd_ < 0)
+  {
+    return;
+  }
+
+  const uint64_t value = 1;
+  if(::write(eventFd_, &value, sizeof(value)) < 0)
+  {
+    ASCTEC_ERROR_STREAM("Error while writing the eventfd: " << strerror(errno));
+  }
+}
+
+#else
+
+Reactor::Reactor(int fd)
+    : fd_(-1), epollFd_(-1), eventFd_(-1)
+{
+}
+
+Reactor::~Reactor()
+{
+}
+
+bool Reactor::isValid() const
+{
+  return false;
+}
+
+bool Reactor::wait(const std::chrono::milliseconds& timeout)
+{
+  return false;
+}
+
+void Reactor::wakeup()
+{
+}
+
+#endif
+
+} // end namespace asctec_comm
@@ -0,0 +1,207 @@
+/*
+ * Copyright (C) 2017 Intel Deutschland GmbH, Germany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <random>
+
+#include <asctec_comm/simulated_link.h>
+
+namespace asctec_comm
+{
+
+/// One direction of the link.
+class SimulatedLink::Channel
+{
+public:
+  typedef std::chrono::steady_clock Clock;
+
+  Channel(const SimulatedLinkParameters& parameters, unsigned int seed)
+      : parameters_(parameters), byteTime_(std::chrono::nanoseconds(10000000000LL / parameters.baudRate)),
+        lineFree_(Clock::now()), generator_(seed), uniform_(0.0, 1.0), statistics_()
+  {
+  }
+
+  int write(const uint8_t* data, int size)
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    const Clock::time_point now = Clock::now();
+    if(lineFree_ < now)
+    {
+      lineFree_ = now;
+    }
+
+    // bytes still waiting for transmission occupy the FIFO, including the one on the line
+    const size_t queued = (lineFree_ - now + byteTime_ - Clock::duration(1)) / byteTime_;
+    const size_t accepted = std::min<size_t>(size, parameters_.txFifoSize - std::min(queued, parameters_.txFifoSize));
+
+    for(size_t i = 0; i < accepted; ++i)
+    {
+      lineFree_ += byteTime_;
+
+      uint8_t c = data[i];
+      if(applyErrors(&c))
+      {
+        bytes_.push_back(Byte { c, lineFree_ + parameters_.latency });
+      }
+    }
+
+    statistics_.bytesWritten += accepted;
+    lock.unlock();
+    condition_.notify_all();
+
+    return accepted;
+  }
+
+  int read(uint8_t* data, int size)
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    const Clock::time_point timeout = Clock::now() + parameters_.readTimeout;
+
+    // wait for the first byte to arrive, new bytes may be written meanwhile
+    while(true)
+    {
+      const Clock::time_point now = Clock::now();
+      if(!bytes_.empty() && bytes_.front().arrival <= now)
+      {
+        break;
+      }
+      if(now >= timeout)
+      {
+        return 0;
+      }
+
+      const Clock::time_point wakeup = bytes_.empty() ? timeout : std::min(timeout, bytes_.front().arrival);
+      condition_.wait_until(lock, wakeup);
+    }
+
+    const Clock::time_point now = Clock::now();
+    int n = 0;
+    while(n < size && !bytes_.empty() && bytes_.front().arrival <= now)
+    {
+      data[n++] = bytes_.front().value;
+      bytes_.pop_front();
+    }
+
+    return n;
+  }
+
+  SimulatedLinkStatistics getStatistics() const
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return statistics_;
+  }
+
+private:
+  struct Byte
+  {
+    uint8_t value;
+    Clock::time_point arrival;
+  };
+
+  // Returns false if the byte is lost.
+  bool applyErrors(uint8_t* c)
+  {
+    if(burstRemaining_ == 0 && parameters_.burstErrorRate > 0.0 && uniform_(generator_) < parameters_.burstErrorRate)
+    {
+      burstRemaining_ = parameters_.burstLength;
+    }
+
+    if(burstRemaining_ > 0)
+    {
+      --burstRemaining_;
+      *c = generator_();
+      ++statistics_.bytesCorrupted;
+      return true;
+    }
+
+    if(parameters_.byteDropRate > 0.0 && uniform_(generator_) < parameters_.byteDropRate)
+    {
+      ++statistics_.bytesDropped;
+      return false;
+    }
+
+    if(parameters_.bitErrorRate > 0.0)
+    {
+      uint8_t flips = 0;
+      for(int bit = 0; bit < 8; ++bit)
+      {
+        if(uniform_(generator_) < parameters_.bitErrorRate)
+        {
+          flips |= 1 << bit;
+        }
+      }
+
+      if(flips)
+      {
+        *c ^= flips;
+        ++statistics_.bytesCorrupted;
+      }
+    }
+
+    return true;
+  }
+
+  const SimulatedLinkParameters parameters_;
+  const Clock::duration byteTime_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable condition_;
+  std::deque<Byte> bytes_;  // in flight or arrived, ordered by arrival
+  Clock::time_point lineFree_;  // end of the transmission of the last byte written
+
+  std::mt19937 generator_;
+  std::uniform_real_distribution<double> uniform_;
+  size_t burstRemaining_ = 0;
+
+  SimulatedLinkStatistics statistics_;
+};
+
+void SimulatedLink::createPair(const SimulatedLinkParameters& parameters, std::shared_ptr<SimulatedLink>* a,
+    std::shared_ptr<SimulatedLink>* b)
+{
+  // different, but reproducible errors in both directions
+  std::shared_ptr<Channel> ab = std::make_shared<Channel>(parameters, parameters.seed);
+  std::shared_ptr<Channel> ba = std::make_shared<Channel>(parameters, parameters.seed + 1);
+
+  a->reset(new SimulatedLink(ba, ab));
+  b->reset(new SimulatedLink(ab, ba));
+}
+
+SimulatedLink::SimulatedLink(std::shared_ptr<Channel> rx, std::shared_ptr<Channel> tx)
+    : RawBuffer(), rx_(rx), tx_(tx)
+{
+}
+
+int SimulatedLink::writeBuffer(uint8_t* data, int size)
+{
+  return tx_->write(data, size);
+}
+
+int SimulatedLink::readBuffer(uint8_t* data, int size)
+{
+  return rx_->read(data, size);
+}
+
+SimulatedLinkStatistics SimulatedLink::getTxStatistics() const
+{
+  return tx_->getStatistics();
+}
+
+} // end namespace asctec_comm
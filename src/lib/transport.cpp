@@ -14,14 +14,23 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+#include <array>
+
 #include <asctec_comm/transport.h>
 #include <asctec_uav_msgs/transport_definitions.h>
 
 namespace asctec_comm
 {
 
+constexpr size_t Transport::kDefaultAckWindow;
+constexpr size_t Transport::kMaxAckBacklog;
+
 Transport::Transport(std::shared_ptr<DataLink> dataLink)
-    : sendQueue_(100), receiveQueue_(100), nextAckId_(0), shutdownRequested_(false)
+    : sendQueue_(100), nFramesQueued_(0), receiveQueue_(100), ackWindow_(kDefaultAckWindow), nAcksInFlight_(0), nextAckId_(0),
+      rttValid_(false), smoothedRtt_(0), rttVariation_(0), retransmissionTimeout_(retransmissionPolicy_.initialTimeout),
+      ackStatistics_(), queueUnsubscribed_(true), peerDecodesDelta_(false),
+      shutdownRequested_(false)
 {
   if(!dataLink)
   {
@@ -30,6 +39,15 @@ Transport::Transport(std::shared_ptr<DataLink> dataLink)
   }
 
   dataLink_ = dataLink;
+  framePool_ = dataLink_->getFramePool();
+
+  // without a file descriptor the receive thread relies on the read timeout of the raw buffer
+  receiveReactor_.reset(new Reactor(dataLink_->getFileDescriptor()));
+  if(!receiveReactor_->isValid())
+  {
+    receiveReactor_.reset();
+  }
+
   sendThread_ = std::thread(&Transport::sendThread, this);
   receiveThread_ = std::thread(&Transport::receiveThread, this);
 }
@@ -38,6 +56,12 @@ Transport::~Transport()
 {
   shutdownRequested_ = true;
 
+  if(receiveReactor_)
+  {
+    receiveReactor_->wakeup();
+  }
+  sendQueue_.interrupt();
+
   if(sendThread_.joinable())
   {
     sendThread_.join();
@@ -47,91 +71,688 @@ Transport::~Transport()
   {
     receiveThread_.join();
   }
+
+  // nobody is going to complete them anymore
+  std::unordered_map<uint16_t, PendingAck> pendingAcks;
+  std::deque<PendingAck> ackBacklog;
+  {
+    UniqueLock lock(ackMutex_);
+    pendingAcks.swap(pendingAcks_);
+    ackBacklog.swap(ackBacklog_);
+    ackTimeouts_.clear();
+  }
+  for(auto& pendingAck : pendingAcks)
+  {
+    pendingAck.second.callback(false);
+  }
+  for(auto& pendingAck : ackBacklog)
+  {
+    pendingAck.callback(false);
+  }
 }
 
 void Transport::sendThread()
 {
+  // frames waiting in the queue are written together to save on system calls
+  constexpr size_t kMaxBatchSize = 16;
+  std::array<Frame, kMaxBatchSize> frames;
+  std::array<ConstBuffer, 2 * kMaxBatchSize> segments;
+
+  // frames the datalink did not accept yet, they are kept at the front of "frames"
+  size_t nFrames = 0;
+
   while(!shutdownRequested_)
   {
-    ByteVector frame;
-    bool success = sendQueue_.popWithTimeout(std::chrono::milliseconds(100), &frame);
+    const std::chrono::steady_clock::time_point nextAckDeadline = expireAcks();
+
+    // carried over frames are delta coded already
+    const size_t nEncoded = nFrames;
 
-    if(!success)
+    if(nFrames == 0)
     {
-      continue;
+      // Poll more often while the datalink still has data to write out, wake up in time for the next ack timeout.
+      // Changes to the pending acks interrupt the wait, so the timeout is recomputed right away.
+      const bool flushed = dataLink_->flush();
+      std::chrono::steady_clock::duration timeout = std::chrono::milliseconds(flushed ? 100 : 1);
+      timeout = std::min(timeout, nextAckDeadline - std::chrono::steady_clock::now());
+      timeout = std::max(timeout, std::chrono::steady_clock::duration::zero());
+
+      if(!sendQueue_.popWithTimeout(timeout, &frames[0]))
+      {
+        continue;
+      }
+      nFrames = 1;
+    }
+
+    while(nFrames < kMaxBatchSize && sendQueue_.tryPop(&frames[nFrames]))
+    {
+      ++nFrames;
+    }
+
+    // delta coding happens here, in the order frames go out
+    for(size_t i = nEncoded; i < nFrames; ++i)
+    {
+      encodeDelta(&frames[i]);
+    }
+
+    for(size_t i = 0; i < nFrames; ++i)
+    {
+      segments[2 * i] = { frames[i].header_, POS_DATAGRAM };
+      segments[2 * i + 1] = { frames[i].payload_.data(), frames[i].payload_.size() };
+    }
+
+    const size_t nSent = dataLink_->sendFrames(segments.data(), 2, nFrames);
+    nFramesQueued_ -= nSent;
+
+    // the round trip of acknowledged messages starts now, not when they were queued
+    std::array<uint16_t, kMaxBatchSize> ackIds;
+    size_t nAckIds = 0;
+    for(size_t i = 0; i < nSent; ++i)
+    {
+      int32_t id;
+      uint16_t flags;
+      deserializeHeader(frames[i].header_, &id, &flags, &ackIds[nAckIds]);
+      if(flags & asctec_uav_msgs::TRANSPORT_FLAG_ACK_REQUEST)
+      {
+        ++nAckIds;
+      }
+    }
+    if(nAckIds > 0)
+    {
+      markAcksSent(ackIds.data(), nAckIds, std::chrono::steady_clock::now());
     }
 
-    dataLink_->sendFrame(frame);
+    if(nSent < nFrames)
+    {
+      // The link is busy. Keep the rest, the queue fills up meanwhile and sendData reports it to the caller.
+      // A self move would clear the payloads, so only move if something was sent.
+      if(nSent > 0)
+      {
+        std::move(frames.begin() + nSent, frames.begin() + nFrames, frames.begin());
+      }
+      nFrames -= nSent;
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    else
+    {
+      nFrames = 0;
+    }
+  }
+}
+
+void Transport::setDeltaEncoding(uint32_t id, unsigned int keyframeInterval)
+{
+  deltaEncoder_.setKeyframeInterval(id, keyframeInterval);
+}
+
+void Transport::encodeDelta(Frame* frame)
+{
+  int32_t id;
+  uint16_t flags, ackId;
+  deserializeHeader(frame->header_, &id, &flags, &ackId);
+
+  // the ack id field carries the position in the delta chain, so acknowledged messages are always sent in full
+  if(flags != 0)
+  {
+    return;
+  }
+
+  uint16_t seq;
+  if(deltaEncoder_.encode(id, &frame->payload_, &flags, &seq, !peerDecodesDelta_))
+  {
+    serializeHeader(id, flags, seq, frame->header_);
   }
 }
 
+size_t Transport::getSendQueueSize() const
+{
+  return sendQueue_.size();
+}
+
+size_t Transport::getMaxDatagramSize() const
+{
+  return dataLink_->getMaxFrameSize() - POS_DATAGRAM;
+}
+
+bool Transport::checkDatagramSize(size_t size) const
+{
+  if(size > getMaxDatagramSize())
+  {
+    ASCTEC_ERROR_STREAM("datagram of " << size << " bytes exceeds the maximum of " << getMaxDatagramSize() << " bytes");
+    return false;
+  }
+  return true;
+}
+
 void Transport::receiveThread()
 {
+  // built once, the datalink hands each frame to it straight from its decode buffer
+  const DataLink::FrameVisitor visitor =
+      [this](const uint8_t* frame, size_t size, std::chrono::steady_clock::time_point timestamp)
+      {
+        handleFrame(frame, size, timestamp);
+      };
+
   while(!shutdownRequested_)
   {
-    std::vector<ByteVector> frames;
-    dataLink_->pollFramesUnBuffered(&frames);
-    if(frames.empty())
+    // sleep until bytes arrive, the destructor wakes the reactor up
+    if(receiveReactor_ && !receiveReactor_->wait(std::chrono::milliseconds(1000)))
     {
       continue;
     }
 
-    for(auto& frame : frames)
+    dataLink_->pollFrames(visitor);
+  }
+}
+
+void Transport::handleFrame(const uint8_t* frame, size_t size, std::chrono::steady_clock::time_point timestamp)
+{
+  if(size < POS_DATAGRAM)
+  {
+    ASCTEC_WARN_STREAM("Frame size smaller than header size. This should not happen.");
+    return;
+  }
+
+  // only the header is looked at, the payload is copied just if a datagram is queued for the user
+  int32_t id;
+  uint16_t flags, ackId;
+  deserializeHeader(frame, &id, &flags, &ackId);
+
+  if(flags & asctec_uav_msgs::TRANSPORT_FLAG_ACK_REQUEST)
+  {
+    Frame response;
+    serializeHeader(id, asctec_uav_msgs::TRANSPORT_FLAG_ACK_RESPONSE, ackId, response.header_);
+    if(!queueFrame(std::move(response)))
+    {
+      ASCTEC_WARN_STREAM("send queue full, dropping ack response");
+    }
+  }
+  else if(flags & asctec_uav_msgs::TRANSPORT_FLAG_ACK_RESPONSE)
+  {
+    if(flags & delta::FLAG_KEYFRAME)
+    {
+      peerDecodesDelta_ = true;
+    }
+    else
     {
-      if(frame.size() < POS_DATAGRAM)
+      completeAck(ackId, true);
+    }
+  }
+  else
+  {
+    if(flags & delta::FLAG_KEYFRAME)
+    {
+      // lets the sender switch from keyframes to deltas
+      Frame answer;
+      serializeHeader(id, asctec_uav_msgs::TRANSPORT_FLAG_ACK_RESPONSE | delta::FLAG_KEYFRAME, ackId, answer.header_);
+      if(!queueFrame(std::move(answer)))
       {
-        ASCTEC_WARN_STREAM("Frame size smaller than header size. This should not happen.");
-        continue;
+        ASCTEC_WARN_STREAM("send queue full, dropping keyframe answer");
       }
+    }
 
-      uint16_t flags, ackId;
-      Datagram datagram;
-      deserialize(frame, &(datagram.id_), &flags, &ackId, &(datagram.data_));
+    const SubscriptionPtr subscription = findSubscription(id);
+    if(!subscription && !queueUnsubscribed_)
+    {
+      return;
+    }
 
-      if(flags & asctec_uav_msgs::TRANSPORT_FLAG_ACK_REQUEST)
+    if(subscription && !subscription->executor)
+    {
+      const uint8_t* payload = frame + POS_DATAGRAM;
+      size_t payloadSize = size - POS_DATAGRAM;
+
+      if(flags & delta::FLAGS_MASK)
       {
-        ByteVector frame, dummy;
-        serialize(datagram.id_, asctec_uav_msgs::TRANSPORT_FLAG_ACK_RESPONSE, ackId, dummy.begin(), dummy.end(), &frame);
-        sendQueue_.push(frame);
+        if(!deltaDecoder_.decode(id, flags, ackId, payload, payloadSize, &receiveDeltaBuffer_))
+        {
+          return;
+        }
+        payload = receiveDeltaBuffer_.data();
+        payloadSize = receiveDeltaBuffer_.size();
       }
-      else if(flags & asctec_uav_msgs::TRANSPORT_FLAG_ACK_RESPONSE)
+
+      subscription->callback(id, payload, payloadSize, timestamp);
+      return;
+    }
+
+    Datagram datagram;
+    datagram.id_ = id;
+    datagram.timestamp_ = timestamp;
+    framePool_->acquire(&datagram.data_);
+
+    if(flags & delta::FLAGS_MASK)
+    {
+      if(!deltaDecoder_.decode(id, flags, ackId, frame + POS_DATAGRAM, size - POS_DATAGRAM, &datagram.data_))
       {
-        UniqueLock lock(ackMutex_);
-        pendingAcks_.insert(ackId);
-        lock.unlock();
-        ackCondition_.notify_all();
+        framePool_->release(&datagram.data_);
+        return;
       }
-      else
+    }
+    else
+    {
+      datagram.data_.assign(frame + POS_DATAGRAM, frame + size);
+    }
+
+    if(subscription)
+    {
+      postDatagram(subscription, &datagram);
+      return;
+    }
+
+    // like a full ThreadSafeQueue, the oldest datagram makes room, but its buffer goes back to the pool
+    while(!receiveQueue_.tryPush(std::move(datagram)))
+    {
+      Datagram discarded;
+      if(receiveQueue_.tryPop(&discarded))
       {
-        receiveQueue_.push(datagram);
+        ASCTEC_WARN_STREAM("receive queue full, discarding the oldest datagram");
+        framePool_->release(&discarded.data_);
       }
     }
   }
 }
 
-void Transport::deserialize(const ByteVector& frame, int32_t* id, uint16_t* flags, uint16_t* ackId,
-    ByteVector* datagram)
+void Transport::setAckWindow(size_t window)
 {
-  if(id)
+  Transmissions transmissions;
+  std::vector<AckCallback> failed;
+
+  UniqueLock lock(ackMutex_);
+  ackWindow_ = std::max<size_t>(1, std::min<size_t>(window, 32767));
+  fillAckWindow(std::chrono::steady_clock::now(), &transmissions, &failed);
+  lock.unlock();
+
+  pushTransmissions(&transmissions);
+  for(auto& callback : failed)
   {
-    *id = *reinterpret_cast<const uint32_t*>(frame.data() + POS_ID);
+    callback(false);
   }
+}
 
-  if(flags)
+void Transport::setRetransmissionPolicy(const RetransmissionPolicy& policy)
+{
+  UniqueLock lock(ackMutex_);
+  retransmissionPolicy_ = policy;
+  retransmissionPolicy_.maxAttempts = std::max(1u, policy.maxAttempts);
+
+  if(!rttValid_)
   {
-    *flags = *reinterpret_cast<const uint16_t*>(frame.data() + POS_FLAGS);
+    retransmissionTimeout_ = retransmissionPolicy_.initialTimeout;
   }
+  lock.unlock();
+
+  sendQueue_.interrupt();
+}
 
-  if(ackId)
+AckStatistics Transport::getAckStatistics() const
+{
+  UniqueLock lock(ackMutex_);
+
+  AckStatistics statistics = ackStatistics_;
+  statistics.smoothedRtt = std::chrono::duration_cast<std::chrono::microseconds>(smoothedRtt_);
+  statistics.rttVariation = std::chrono::duration_cast<std::chrono::microseconds>(rttVariation_);
+  statistics.retransmissionTimeout = std::chrono::duration_cast<std::chrono::microseconds>(retransmissionTimeout_);
+  return statistics;
+}
+
+void Transport::sendAcknowledged(Frame* frame, std::chrono::steady_clock::duration timeout,
+    const AckCallback& callback)
+{
+  const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  Transmissions transmissions;
+  std::vector<AckCallback> failed;
+
+  UniqueLock lock(ackMutex_);
+  if(ackBacklog_.size() >= kMaxAckBacklog)
   {
-    *ackId = *reinterpret_cast<const uint16_t*>(frame.data() + POS_ACK_ID);
+    ++ackStatistics_.messagesFailed;
+    lock.unlock();
+
+    ASCTEC_WARN_STREAM("ack backlog full, dropping message");
+    callback(false);
+    return;
   }
 
-  if(datagram)
+  // every message passes the backlog, the ack id is assigned once it enters the window
+  ackBacklog_.emplace_back();
+  PendingAck& pendingAck = ackBacklog_.back();
+  pendingAck.frame = std::move(*frame);
+  pendingAck.callback = callback;
+  pendingAck.deadline = now + timeout;
+  pendingAck.nAttempts = 0;
+  pendingAck.timeoutEntry = ackTimeouts_.end();
+
+  fillAckWindow(now, &transmissions, &failed);
+  lock.unlock();
+
+  pushTransmissions(&transmissions);
+
+  // the send thread may sleep past the deadline of the new message otherwise
+  sendQueue_.interrupt();
+
+  for(auto& failedCallback : failed)
   {
-    datagram->clear();
-    datagram->insert(datagram->begin(), frame.cbegin() + POS_DATAGRAM, frame.cend());
+    failedCallback(false);
   }
 }
 
+void Transport::completeAck(uint16_t ackId, bool acknowledged)
+{
+  const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  Transmissions transmissions;
+  std::vector<AckCallback> failed;
+
+  UniqueLock lock(ackMutex_);
+
+  // late or duplicate acknowledgements of messages that already completed
+  auto it = pendingAcks_.find(ackId);
+  if(it == pendingAcks_.end())
+  {
+    return;
+  }
+
+  // Karn's algorithm, it is unknown which transmission a retransmitted message was acknowledged for. An ack that
+  // overtook markAcksSent() is not measured either.
+  if(acknowledged && it->second.nAttempts == 1 && it->second.sent != std::chrono::steady_clock::time_point())
+  {
+    updateRtt(now - it->second.sent);
+  }
+
+  ++(acknowledged ? ackStatistics_.messagesAcknowledged : ackStatistics_.messagesFailed);
+
+  AckCallback callback;
+  callback.swap(it->second.callback);
+  if(it->second.timeoutEntry != ackTimeouts_.end())
+  {
+    ackTimeouts_.erase(it->second.timeoutEntry);
+  }
+  pendingAcks_.erase(it);
+  --nAcksInFlight_;
+
+  fillAckWindow(now, &transmissions, &failed);
+  lock.unlock();
+
+  pushTransmissions(&transmissions);
+
+  // the earliest timeout and the window changed, let the send thread wait for the right one
+  sendQueue_.interrupt();
+
+  for(auto& failedCallback : failed)
+  {
+    failedCallback(false);
+  }
+  callback(acknowledged);
+}
+
+void Transport::fillAckWindow(std::chrono::steady_clock::time_point now, Transmissions* transmissions,
+    std::vector<AckCallback>* failed)
+{
+  while(nAcksInFlight_ < ackWindow_ && !ackBacklog_.empty())
+  {
+    PendingAck& backlogged = ackBacklog_.front();
+
+    // deadlines in the backlog are only looked at here, not on every pass of the send thread
+    if(backlogged.deadline <= now)
+    {
+      ++ackStatistics_.messagesFailed;
+      failed->push_back(std::move(backlogged.callback));
+      ackBacklog_.pop_front();
+      continue;
+    }
+
+    // The window is far smaller than the id space, so this skips at most a few ids of messages that stayed in
+    // flight while the ids wrapped around.
+    while(pendingAcks_.count(nextAckId_) > 0)
+    {
+      ++nextAckId_;
+    }
+    const uint16_t ackId = nextAckId_++;
+
+    PendingAck& pendingAck = pendingAcks_[ackId];
+    pendingAck = std::move(backlogged);
+    ackBacklog_.pop_front();
+
+    int32_t id;
+    uint16_t flags, unused;
+    deserializeHeader(pendingAck.frame.header_, &id, &flags, &unused);
+    serializeHeader(id, flags, ackId, pendingAck.frame.header_);
+
+    ++nAcksInFlight_;
+    transmitAck(ackId, &pendingAck, now, transmissions);
+  }
+}
+
+std::chrono::steady_clock::time_point Transport::expireAcks()
+{
+  const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  std::chrono::steady_clock::time_point nextTimeout = std::chrono::steady_clock::time_point::max();
+  std::vector<uint16_t> expired;
+  Transmissions transmissions;
+  std::vector<AckCallback> failed;
+
+  {
+    UniqueLock lock(ackMutex_);
+
+    // only the acks that are due are looked at, a retransmission reschedules its entry past "now"
+    auto entry = ackTimeouts_.begin();
+    while(entry != ackTimeouts_.end() && entry->first <= now)
+    {
+      const uint16_t ackId = entry->second;
+      PendingAck& pendingAck = pendingAcks_[ackId];
+      ++entry;
+
+      if(pendingAck.deadline <= now || pendingAck.nAttempts >= retransmissionPolicy_.maxAttempts)
+      {
+        ackTimeouts_.erase(pendingAck.timeoutEntry);
+        pendingAck.timeoutEntry = ackTimeouts_.end();
+        expired.push_back(ackId);
+        continue;
+      }
+
+      ++ackStatistics_.retransmissions;
+      transmitAck(ackId, &pendingAck, now, &transmissions);
+    }
+
+    // messages that went back to the backlog because the send queue was full
+    fillAckWindow(now, &transmissions, &failed);
+
+    if(!ackTimeouts_.empty())
+    {
+      nextTimeout = ackTimeouts_.begin()->first;
+    }
+  }
+
+  pushTransmissions(&transmissions);
+
+  for(auto& callback : failed)
+  {
+    callback(false);
+  }
+
+  for(uint16_t ackId : expired)
+  {
+    completeAck(ackId, false);
+  }
+
+  return nextTimeout;
+}
+
+void Transport::transmitAck(uint16_t ackId, PendingAck* pendingAck, std::chrono::steady_clock::time_point now,
+    Transmissions* transmissions)
+{
+  if(pendingAck->nAttempts == 0)
+  {
+    ++ackStatistics_.messagesSent;
+    pendingAck->timeout = retransmissionTimeout_;
+  }
+  else
+  {
+    // Every retransmission of a message doubles its timeout. Like the RFC 6298 back off, following messages start
+    // with the longer timeout until a round trip is measured again.
+    pendingAck->timeout = std::min<std::chrono::steady_clock::duration>(2 * pendingAck->timeout,
+        retransmissionPolicy_.maxTimeout);
+    retransmissionTimeout_ = std::max(retransmissionTimeout_, pendingAck->timeout);
+  }
+
+  ++pendingAck->nAttempts;
+
+  // Waiting in the send queue is not part of the round trip, the timers start once the send thread wrote the frame
+  // in markAcksSent(). Until then only the deadline of the caller applies.
+  pendingAck->sent = std::chrono::steady_clock::time_point();
+  pendingAck->retransmit = std::chrono::steady_clock::time_point::max();
+  scheduleAck(ackId, pendingAck);
+
+  transmissions->emplace_back(ackId, pendingAck->frame);
+}
+
+void Transport::scheduleAck(uint16_t ackId, PendingAck* pendingAck)
+{
+  if(pendingAck->timeoutEntry != ackTimeouts_.end())
+  {
+    ackTimeouts_.erase(pendingAck->timeoutEntry);
+  }
+  pendingAck->timeoutEntry = ackTimeouts_.emplace(std::min(pendingAck->retransmit, pendingAck->deadline), ackId);
+}
+
+void Transport::pushTransmissions(Transmissions* transmissions)
+{
+  std::vector<uint16_t> notQueued;
+  for(auto& transmission : *transmissions)
+  {
+    if(!queueFrame(std::move(transmission.second)))
+    {
+      notQueued.push_back(transmission.first);
+    }
+  }
+
+  if(notQueued.empty())
+  {
+    return;
+  }
+
+  // The send queue is full for now. The messages go back to the front of the backlog in their order, expireAcks()
+  // moves them into the window again with a new ack id.
+  UniqueLock lock(ackMutex_);
+  for(auto it = notQueued.rbegin(); it != notQueued.rend(); ++it)
+  {
+    auto pending = pendingAcks_.find(*it);
+    if(pending == pendingAcks_.end())
+    {
+      continue;
+    }
+
+    PendingAck& pendingAck = pending->second;
+    if(pendingAck.timeoutEntry != ackTimeouts_.end())
+    {
+      ackTimeouts_.erase(pendingAck.timeoutEntry);
+    }
+
+    // not sent after all, it is counted again once it enters the window
+    --ackStatistics_.messagesSent;
+    if(pendingAck.nAttempts > 1)
+    {
+      --ackStatistics_.retransmissions;
+    }
+
+    pendingAck.nAttempts = 0;
+    pendingAck.timeoutEntry = ackTimeouts_.end();
+    ackBacklog_.push_front(std::move(pendingAck));
+    pendingAcks_.erase(pending);
+    --nAcksInFlight_;
+  }
+}
+
+void Transport::markAcksSent(const uint16_t* ackIds, size_t nAckIds, std::chrono::steady_clock::time_point now)
+{
+  UniqueLock lock(ackMutex_);
+  for(size_t i = 0; i < nAckIds; ++i)
+  {
+    // completed already if the ack was faster than this thread
+    auto it = pendingAcks_.find(ackIds[i]);
+    if(it == pendingAcks_.end())
+    {
+      continue;
+    }
+
+    PendingAck& pendingAck = it->second;
+    pendingAck.sent = now;
+    pendingAck.retransmit = now + pendingAck.timeout;
+    scheduleAck(it->first, &pendingAck);
+  }
+}
+
+void Transport::updateRtt(std::chrono::steady_clock::duration rtt)
+{
+  // RFC 6298 with alpha = 1/8, beta = 1/4 and K = 4, the clock granularity is that of the send thread
+  constexpr std::chrono::milliseconds kGranularity(1);
+
+  if(!rttValid_)
+  {
+    smoothedRtt_ = rtt;
+    rttVariation_ = rtt / 2;
+    rttValid_ = true;
+  }
+  else
+  {
+    const std::chrono::steady_clock::duration error = smoothedRtt_ > rtt ? smoothedRtt_ - rtt : rtt - smoothedRtt_;
+    rttVariation_ = (3 * rttVariation_ + error) / 4;
+    smoothedRtt_ = (7 * smoothedRtt_ + rtt) / 8;
+  }
+
+  retransmissionTimeout_ = smoothedRtt_ + std::max<std::chrono::steady_clock::duration>(kGranularity, 4 * rttVariation_);
+  retransmissionTimeout_ = std::max<std::chrono::steady_clock::duration>(retransmissionTimeout_,
+      retransmissionPolicy_.minTimeout);
+  retransmissionTimeout_ = std::min<std::chrono::steady_clock::duration>(retransmissionTimeout_,
+      retransmissionPolicy_.maxTimeout);
+}
+
+void Transport::subscribe(uint32_t id, const DataCallback& callback, const Executor& executor)
+{
+  SubscriptionPtr subscription(new Subscription { callback, executor });
+
+  std::lock_guard<std::mutex> lock(subscriptionMutex_);
+  subscriptions_[id] = subscription;
+}
+
+void Transport::unsubscribe(uint32_t id)
+{
+  std::lock_guard<std::mutex> lock(subscriptionMutex_);
+  subscriptions_.erase(id);
+}
+
+void Transport::setQueueUnsubscribed(bool queue)
+{
+  queueUnsubscribed_ = queue;
+}
+
+Transport::SubscriptionPtr Transport::findSubscription(uint32_t id)
+{
+  std::lock_guard<std::mutex> lock(subscriptionMutex_);
+
+  auto it = subscriptions_.find(id);
+  if(it == subscriptions_.end())
+  {
+    return SubscriptionPtr();
+  }
+
+  return it->second;
+}
+
+void Transport::postDatagram(const SubscriptionPtr& subscription, Datagram* datagram)
+{
+  // std::function needs a copyable task, so the datagram is shared with it
+  std::shared_ptr<Datagram> shared = std::make_shared<Datagram>();
+  shared->id_ = datagram->id_;
+  shared->timestamp_ = datagram->timestamp_;
+  shared->data_.swap(datagram->data_);
+
+  FramePoolPtr framePool = framePool_;
+  subscription->executor([subscription, shared, framePool]()
+  {
+    subscription->callback(shared->id_, shared->data_.data(), shared->data_.size(), shared->timestamp_);
+    framePool->release(&shared->data_);
+  });
+}
+
 }  // end namespace asctec_comm
@@ -16,7 +16,7 @@
 
 #include "loopback.h"
 
-namespace trinity_comm
+namespace asctec_comm
 {
 
 Loopback::Loopback()
@@ -70,4 +70,4 @@ LoopbackBridge::LoopbackBridge()
   txRxLoopback_.reset(new DoubleLoopBack(txRx_, rxTx_));
 }
 
-}  // end namespace trinity_comm
+}  // end namespace asctec_comm
@@ -20,7 +20,7 @@
 #include <asctec_comm/raw_buffer.h>
 #include <asctec_comm/thread_safe_queue.h>
 
-namespace trinity_comm
+namespace asctec_comm
 {
 
 class Loopback : public RawBuffer
@@ -71,5 +71,5 @@ private:
   Loopback txRx_;
 };
 
-}  // end namespace trinity_comm
+}  // end namespace asctec_comm
 #endif /* SRC_TEST_LOOPBACK_H_ */
@@ -14,17 +14,19 @@
  * limitations under the License.
  */
 
+#include <algorithm>
 #include <stdlib.h>
 #include <random>
 
 #include <gtest/gtest.h>
 
 #include <asctec_comm/cobs.h>
+#include <asctec_uav_msgs/crc16.h>
 
-using namespace trinity_comm;
+using namespace asctec_comm;
 
 // original decode function
-namespace trinity_comm
+namespace asctec_comm
 {
 namespace cobs
 {
@@ -81,7 +83,7 @@ ByteVector decode(const ByteVector& in)
 }
 }
 
-TEST(trinity_comm, cobs)
+TEST(asctec_comm, cobs)
 {
   srand(123456);
   int maxSize = 100;
@@ -124,6 +126,311 @@ TEST(trinity_comm, cobs)
   }
 }
 
+TEST(asctec_comm, cobs_encode_into_buffer)
+{
+  srand(123456);
+  int maxSize = 1000;
+  int nRuns = 100;
+
+  for (int run = 0; run < nRuns; ++run)
+  {
+    ByteVector dataIn;
+    dataIn.resize(rand()%maxSize);
+
+    for (auto& i : dataIn)
+    {
+      // plenty of zeros to exercise ZPE and ZRE
+      i = (rand() % 4) ? 0 : rand();
+    }
+
+    cobs::Encoder enc;
+    enc << dataIn;
+    ByteVector dataEnc = enc.getResult();
+
+    ByteVector buffer(cobs::Encoder::getMaxEncodedSize(dataIn.size()));
+    size_t size = cobs::encode(dataIn.data(), dataIn.size(), buffer.data(), buffer.size());
+
+    ASSERT_EQ(dataEnc.size(), size);
+    for (size_t i = 0; i < size; ++i)
+    {
+      EXPECT_EQ(dataEnc[i], buffer[i]) << "at index " << i;
+    }
+
+    // too small buffers are reported, not overrun
+    if (size > 1)
+    {
+      buffer.assign(buffer.size(), 0xAA);
+      EXPECT_EQ(0, cobs::encode(dataIn.data(), dataIn.size(), buffer.data(), size - 1));
+      EXPECT_EQ(0xAA, buffer[size - 1]);
+    }
+  }
+}
+
+TEST(asctec_comm, cobs_encode_into_array)
+{
+  constexpr size_t payloadSize = 500;
+  static_assert(cobs::Encoder::getMaxEncodedSize(payloadSize) > payloadSize, "getMaxEncodedSize is not constexpr");
+
+  std::array<uint8_t, cobs::Encoder::getMaxEncodedSize(payloadSize)> buffer;
+  ByteVector dataIn(payloadSize, 0x55);
+
+  cobs::Encoder enc(&buffer);
+  enc << dataIn;
+  size_t size = enc.finish();
+
+  ASSERT_GT(size, 0);
+  EXPECT_FALSE(enc.overflow());
+
+  ByteVector dataOut = cobs::decode(buffer.begin(), buffer.begin() + size);
+  EXPECT_EQ(dataIn, dataOut);
+}
+
+TEST(asctec_comm, cobs_bulk_feed)
+{
+  srand(123456);
+  int maxSize = 2000;
+  int nRuns = 200;
+
+  for (int run = 0; run < nRuns; ++run)
+  {
+    ByteVector dataIn;
+    dataIn.resize(rand()%maxSize);
+
+    // long literal runs with sparse zeros and occasional zero runs
+    for (auto& i : dataIn)
+    {
+      i = rand() % 256 ? rand() % 255 + 1 : 0;
+    }
+    for (int n = rand() % 4; n > 0 && !dataIn.empty(); --n)
+    {
+      size_t pos = rand() % dataIn.size();
+      size_t len = std::min<size_t>(rand() % 20, dataIn.size() - pos);
+      std::fill(dataIn.begin() + pos, dataIn.begin() + pos + len, 0);
+    }
+
+    cobs::Encoder encBytewise;
+    for (auto& c : dataIn)
+    {
+      encBytewise.feed(c);
+    }
+
+    cobs::Encoder encBulk;
+    encBulk.feed(dataIn.data(), dataIn.size());
+
+    ByteVector dataEnc = encBulk.getResult();
+    EXPECT_EQ(encBytewise.getResult(), dataEnc);
+    EXPECT_EQ(dataIn, cobs::decode(dataEnc));
+    EXPECT_EQ(dataIn, cobs::decode(dataEnc.begin(), dataEnc.end()));
+  }
+}
+
+TEST(asctec_comm, cobs_find_zero)
+{
+  ByteVector data(100, 0xFF);
+  EXPECT_EQ(data.size(), cobs::findZero(data.data(), data.size()));
+
+  for (size_t i = 0; i < data.size(); ++i)
+  {
+    data[i] = 0;
+    for (size_t offset = 0; offset <= i; ++offset)
+    {
+      EXPECT_EQ(i - offset, cobs::findZero(data.data() + offset, data.size() - offset));
+    }
+    data[i] = 0xFF;
+  }
+}
+
+TEST(asctec_comm, cobs_stream_decoder)
+{
+  srand(123456);
+  int maxSize = 1000;
+  int nRuns = 200;
+
+  ByteVector buffer(maxSize);
+  cobs::StreamDecoder decoder(buffer.data(), buffer.size());
+
+  for (int run = 0; run < nRuns; ++run)
+  {
+    ByteVector dataIn;
+    dataIn.resize(rand()%maxSize);
+
+    for (auto& i : dataIn)
+    {
+      i = (rand() % 3) ? rand() : 0;
+    }
+
+    cobs::Encoder enc;
+    enc << dataIn;
+    ByteVector dataEnc = enc.getResult();
+
+    // feed in random chunks, as they would arrive from a serial port
+    decoder.reset();
+    size_t pos = 0;
+    while (pos < dataEnc.size())
+    {
+      size_t chunk = std::min<size_t>(rand() % 50, dataEnc.size() - pos);
+      decoder.feed(dataEnc.data() + pos, chunk);
+      pos += chunk;
+    }
+
+    size_t size = decoder.finish();
+    EXPECT_FALSE(decoder.overflow());
+    ASSERT_EQ(dataIn.size(), size);
+    EXPECT_TRUE(std::equal(dataIn.begin(), dataIn.end(), decoder.data()));
+  }
+
+  // output which does not fit is reported
+  ByteVector dataIn(100, 0x11);
+  cobs::Encoder enc;
+  enc << dataIn;
+  ByteVector dataEnc = enc.getResult();
+
+  cobs::StreamDecoder smallDecoder(buffer.data(), dataIn.size() - 1);
+  smallDecoder.feed(dataEnc.data(), dataEnc.size());
+  EXPECT_EQ(0, smallDecoder.finish());
+  EXPECT_TRUE(smallDecoder.overflow());
+}
+
+TEST(asctec_comm, cobs_fused_crc)
+{
+  srand(123456);
+  int maxSize = 1000;
+  int nRuns = 200;
+
+  ByteVector buffer(maxSize + 2);
+  cobs::StreamDecoder decoder(buffer.data(), buffer.size());
+
+  for (int run = 0; run < nRuns; ++run)
+  {
+    ByteVector dataIn;
+    dataIn.resize(rand()%maxSize);
+
+    for (auto& i : dataIn)
+    {
+      i = (rand() % 3) ? rand() : 0;
+    }
+
+    const uint16_t crcIn = trinity_msgs::crc16(dataIn.begin(), dataIn.end(), 0xffff);
+
+    uint16_t crc = 0xffff;
+    cobs::Encoder enc;
+    enc.feed(dataIn.data(), dataIn.size(), &crc);
+    EXPECT_EQ(crcIn, crc);
+    enc << crc;
+    ByteVector dataEnc = enc.getResult();
+
+    decoder.reset();
+    size_t pos = 0;
+    while (pos < dataEnc.size())
+    {
+      size_t chunk = std::min<size_t>(rand() % 50, dataEnc.size() - pos);
+      decoder.feed(dataEnc.data() + pos, chunk);
+      pos += chunk;
+    }
+
+    ASSERT_EQ(dataIn.size() + 2, decoder.finish());
+    EXPECT_EQ(crcIn, decoder.getCrc());
+  }
+}
+
+TEST(asctec_comm, cobs_segments)
+{
+  srand(123456);
+  int nRuns = 100;
+
+  for (int run = 0; run < nRuns; ++run)
+  {
+    ByteVector header(8), payload(rand() % 500), trailer(4);
+    for (auto* v : { &header, &payload, &trailer })
+    {
+      for (auto& c : *v)
+      {
+        c = (rand() % 3) ? rand() : 0;
+      }
+    }
+
+    ByteVector frame(header);
+    frame.insert(frame.end(), payload.begin(), payload.end());
+    frame.insert(frame.end(), trailer.begin(), trailer.end());
+
+    uint16_t crcFrame = 0xffff;
+    cobs::Encoder encFrame;
+    encFrame.feed(frame.data(), frame.size(), &crcFrame);
+
+    const ConstBuffer segments[] = { { header.data(), header.size() }, { payload.data(), payload.size() },
+        { trailer.data(), trailer.size() } };
+    uint16_t crcSegments = 0xffff;
+    cobs::Encoder encSegments;
+    encSegments.feed(segments, 3, &crcSegments);
+
+    EXPECT_EQ(encFrame.getResult(), encSegments.getResult());
+    EXPECT_EQ(crcFrame, crcSegments);
+  }
+}
+
+TEST(asctec_comm, cobs_decode_checked)
+{
+  srand(123456);
+  int maxSize = 1000;
+  int nRuns = 200;
+
+  ByteVector buffer(maxSize);
+
+  for (int run = 0; run < nRuns; ++run)
+  {
+    ByteVector dataIn;
+    dataIn.resize(rand()%maxSize + 1);
+
+    for (auto& i : dataIn)
+    {
+      i = (rand() % 3) ? rand() : 0;
+    }
+
+    cobs::Encoder enc;
+    enc << dataIn;
+    ByteVector dataEnc = enc.getResult();
+
+    size_t size;
+    ASSERT_EQ(cobs::DecodeStatus::Ok, cobs::decode(dataEnc.data(), dataEnc.size(), buffer.data(), buffer.size(), &size));
+    ASSERT_EQ(dataIn.size(), size);
+    EXPECT_TRUE(std::equal(dataIn.begin(), dataIn.end(), buffer.begin()));
+
+    EXPECT_EQ(cobs::DecodeStatus::Overflow,
+        cobs::decode(dataEnc.data(), dataEnc.size(), buffer.data(), dataIn.size() - 1, &size));
+    EXPECT_LE(size, dataIn.size() - 1);
+
+    // cut off within a literal run, the first byte is always a code
+    if (dataEnc[0] > 2 && dataEnc[0] < 0xD3)
+    {
+      const size_t cut = 2;
+      EXPECT_EQ(cobs::DecodeStatus::Truncated, cobs::decode(dataEnc.data(), cut, buffer.data(), buffer.size(), &size));
+
+      cobs::StreamDecoder decoder(buffer.data(), buffer.size());
+      decoder.feed(dataEnc.data(), cut);
+      decoder.finish();
+      EXPECT_EQ(cobs::DecodeStatus::Truncated, decoder.getStatus());
+    }
+
+    // zero in place of a code
+    ByteVector dataInvalid(dataEnc);
+    dataInvalid.insert(dataInvalid.begin(), 0);
+    EXPECT_EQ(cobs::DecodeStatus::InvalidCode,
+        cobs::decode(dataInvalid.data(), dataInvalid.size(), buffer.data(), buffer.size(), &size));
+
+    cobs::StreamDecoder decoder(buffer.data(), buffer.size());
+    decoder.feed(dataInvalid.data(), dataInvalid.size());
+    decoder.finish();
+    EXPECT_EQ(cobs::DecodeStatus::InvalidCode, decoder.getStatus());
+  }
+
+  // the code claims more data than there is
+  ByteVector bad = { 0x10, 0x01, 0x02 };
+  size_t size;
+  EXPECT_EQ(cobs::DecodeStatus::Truncated, cobs::decode(bad.data(), bad.size(), buffer.data(), buffer.size(), &size));
+  EXPECT_EQ(2, size);
+  EXPECT_EQ(2, cobs::decode(bad.begin(), bad.end()).size());
+}
+
 int main(int argc, char **argv)
 {
   testing::InitGoogleTest(&argc, argv);
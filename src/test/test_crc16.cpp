@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2017 Intel Deutschland GmbH, Germany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+
+#include <gtest/gtest.h>
+
+#include <asctec_comm/crc16.h>
+#include <asctec_comm/macros.h>
+#include <asctec_comm/types.h>
+#include <asctec_uav_msgs/crc16.h>
+
+using namespace asctec_comm;
+
+TEST(asctec_comm, crc16_matches_trinity_msgs)
+{
+  srand(123456);
+  int maxSize = 3000;
+  int nRuns = 500;
+
+  ASCTEC_INFO_STREAM("clmul supported: " << crc::isClmulSupported() << ", selected implementation: "
+      << static_cast<int>(crc::getImplementation()));
+
+  for (int run = 0; run < nRuns; ++run)
+  {
+    // random sizes and alignments
+    ByteVector data(rand() % maxSize + 16);
+    for (auto& c : data)
+    {
+      c = rand();
+    }
+    const size_t offset = rand() % 16;
+    const uint8_t* first = data.data() + offset;
+    const uint8_t* last = data.data() + data.size();
+    const uint16_t init = (run % 2) ? 0xffff : rand();
+
+    const uint16_t expected = trinity_msgs::crc16(first, last, init);
+
+    EXPECT_EQ(expected, crc::table(first, last, init));
+    EXPECT_EQ(expected, crc::slicingBy8(first, last, init));
+    if (crc::isClmulSupported())
+    {
+      EXPECT_EQ(expected, crc::clmul(first, last, init));
+    }
+    EXPECT_EQ(expected, crc16(first, last, init));
+  }
+}
+
+TEST(asctec_comm, crc16_incremental)
+{
+  ByteVector data(1000);
+  for (size_t i = 0; i < data.size(); ++i)
+  {
+    data[i] = i * 7;
+  }
+
+  const uint16_t expected = crc16(data.data(), data.data() + data.size());
+
+  for (size_t split = 0; split <= data.size(); split += 37)
+  {
+    uint16_t crc = crc16(data.data(), data.data() + split);
+    crc = crc16(data.data() + split, data.data() + data.size(), crc);
+    EXPECT_EQ(expected, crc) << "split at " << split;
+  }
+
+  EXPECT_EQ(0xffff, crc16(data.data(), data.data()));
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
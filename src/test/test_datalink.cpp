@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+#include <algorithm>
 #include <deque>
 #include <stdlib.h>
 #include <random>
@@ -22,10 +23,11 @@
 
 #include <asctec_comm/raw_buffer.h>
 #include <asctec_comm/datalink.h>
+#include <asctec_comm/macros.h>
 
 #include "loopback.h"
 
-using namespace trinity_comm;
+using namespace asctec_comm;
 using namespace std::chrono;
 
 int nRuns = 100;
@@ -49,7 +51,7 @@ std::vector<Data> testDataIn, testDataOut;
 
 void sender()
 {
-  TRINITY_INFO_STREAM("data size " << sizeof(Data));
+  ASCTEC_INFO_STREAM("data size " << sizeof(Data));
   for(auto& data : testDataOut)
   {
     data.timeSent = system_clock::now();
@@ -61,25 +63,21 @@ void sender()
 
 void receiver()
 {
-  Packet dataRec;
+  std::vector<Packet> frames;
   Data data;
   while(!shutdown)
   {
-    bool success = transport->waitForFrame(milliseconds(10), &dataRec);
-    if(success)
+    transport->pollFramesUnBuffered(&frames);
+    for(auto& dataRec : frames)
     {
       memcpy(&data, dataRec.data(), sizeof(Data));
       data.timeReceived = system_clock::now();
       testDataIn.push_back(data);
     }
-    else
-    {
-      // Timeout
-    }
   }
 }
 
-TEST(trinity_comm, datalink)
+TEST(asctec_comm, datalink)
 {
   srand(123456);
 
@@ -150,7 +148,368 @@ TEST(trinity_comm, datalink)
     dtBuf += duration_cast<std::chrono::duration<double>>(dIn.timeReceived - dIn.timeSent).count();
     count += 1.0;
   }
-  TRINITY_INFO_STREAM("Avg transport time: " << dtBuf / count);
+  ASCTEC_INFO_STREAM("Avg transport time: " << dtBuf / count);
+}
+
+TEST(asctec_comm, datalink_send_frames)
+{
+  std::mt19937 generator(123456);
+  std::uniform_int_distribution<int> byte(0, 255);
+  std::uniform_int_distribution<int> length(1, 300);
+
+  // more data than fits into the send buffer at once, so the batch has to be split into several writes
+  constexpr size_t nFrames = 30;
+  std::vector<Packet> header(nFrames), payload(nFrames);
+  std::vector<ConstBuffer> segments;
+  for(size_t i = 0; i < nFrames; ++i)
+  {
+    header[i].resize(4);
+    payload[i].resize(length(generator));
+    for(auto& c : header[i])
+    {
+      c = byte(generator);
+    }
+    for(auto& c : payload[i])
+    {
+      c = byte(generator);
+    }
+    segments.push_back({ header[i].data(), header[i].size() });
+    segments.push_back({ payload[i].data(), payload[i].size() });
+  }
+
+  transport->sendFrames(segments.data(), 2, nFrames);
+
+  std::vector<Packet> received;
+  const auto timeout = steady_clock::now() + seconds(2);
+  while(received.size() < nFrames && steady_clock::now() < timeout)
+  {
+    std::vector<Packet> frames;
+    transport->pollFramesUnBuffered(&frames);
+    received.insert(received.end(), frames.begin(), frames.end());
+  }
+
+  ASSERT_EQ(nFrames, received.size());
+  for(size_t i = 0; i < nFrames; ++i)
+  {
+    Packet expected(header[i]);
+    expected.insert(expected.end(), payload[i].begin(), payload[i].end());
+    EXPECT_EQ(expected, received[i]) << " frame " << i;
+  }
+}
+
+TEST(asctec_comm, datalink_resync_after_overflow)
+{
+  std::shared_ptr<RawBuffer> loopback(new Loopback);
+  DataLink sender(loopback);
+  DataLink receiver(loopback, 64);
+
+  Packet small(32, 0x55), large(200, 0xaa);
+  const ConstBuffer segments[] = { { small.data(), small.size() }, { large.data(), large.size() },
+                                   { small.data(), small.size() }, { small.data(), small.size() } };
+
+  // all frames are written at once, so the oversized one ends up in the same read as its neighbours
+  sender.sendFrames(segments, 1, 4);
+
+  std::vector<Packet> received;
+  const auto timeout = steady_clock::now() + seconds(2);
+  while(received.size() < 3 && steady_clock::now() < timeout)
+  {
+    std::vector<Packet> frames;
+    receiver.pollFramesUnBuffered(&frames);
+    received.insert(received.end(), frames.begin(), frames.end());
+  }
+
+  ASSERT_EQ(3, received.size());
+  for(auto& frame : received)
+  {
+    EXPECT_EQ(small, frame);
+  }
+}
+
+TEST(asctec_comm, datalink_overflow_zero_run)
+{
+  std::shared_ptr<RawBuffer> loopback(new Loopback);
+  DataLink receiver(loopback, 16);
+
+  // the literals fit, but the trailing zero run only expands past the receive capacity when the frame ends
+  Packet oversized(26, 0);
+  std::fill(oversized.begin(), oversized.begin() + 18, 0x55);
+  cobs::Encoder encoder;
+  encoder << oversized;
+  Packet encoded = encoder.getResult();
+  encoded.push_back(0);
+  loopback->writeBuffer(encoded.data(), encoded.size());
+
+  std::vector<Packet> received;
+  const auto timeout = steady_clock::now() + milliseconds(100);
+  while(steady_clock::now() < timeout)
+  {
+    receiver.pollFramesUnBuffered(&received);
+    ASSERT_TRUE(received.empty());
+  }
+
+  const LinkStatistics statistics = receiver.getStatistics();
+  EXPECT_EQ(1, statistics.framesReceivedOverflow);
+  EXPECT_EQ(0, statistics.framesReceivedMalformed);
+}
+
+void sendFramesFillingBuffer(size_t fecParitySize)
+{
+  constexpr size_t maxFrameSize = 100;
+  std::shared_ptr<RawBuffer> loopback(new Loopback);
+  DataLink sender(loopback, maxFrameSize, fecParitySize);
+  DataLink receiver(loopback, maxFrameSize, fecParitySize);
+
+  // without zeros in the payload a frame of the maximum size encodes to exactly the size of the send buffer, so the
+  // following frame starts right at its end
+  const Packet full(maxFrameSize, 0x11), small(8, 0x22);
+  const ConstBuffer segments[] = { { full.data(), full.size() }, { small.data(), small.size() },
+                                   { full.data(), full.size() }, { full.data(), full.size() },
+                                   { small.data(), small.size() } };
+  constexpr size_t nFrames = sizeof(segments) / sizeof(segments[0]);
+
+  // the sequence number and checksum differ between batches, so they shift the encoded size by a byte now and then
+  constexpr size_t nBatches = 8;
+  for(size_t i = 0; i < nBatches; ++i)
+  {
+    EXPECT_EQ(nFrames, sender.sendFrames(segments, 1, nFrames));
+  }
+
+  std::vector<Packet> received;
+  const auto timeout = steady_clock::now() + seconds(2);
+  while(received.size() < nFrames * nBatches && steady_clock::now() < timeout)
+  {
+    std::vector<Packet> frames;
+    receiver.pollFramesUnBuffered(&frames);
+    received.insert(received.end(), frames.begin(), frames.end());
+  }
+
+  ASSERT_EQ(nFrames * nBatches, received.size());
+  for(size_t i = 0; i < received.size(); ++i)
+  {
+    const ConstBuffer& expected = segments[i % nFrames];
+    EXPECT_EQ(Packet(expected.data, expected.data + expected.size), received[i]) << " frame " << i;
+  }
+}
+
+TEST(asctec_comm, datalink_send_frames_fill_buffer)
+{
+  sendFramesFillingBuffer(0);
+}
+
+TEST(asctec_comm, datalink_send_frames_fill_buffer_fec)
+{
+  sendFramesFillingBuffer(16);
+}
+
+TEST(asctec_comm, datalink_fixed_size_frame_fec)
+{
+  std::shared_ptr<RawBuffer> loopback(new Loopback);
+  DataLink link(loopback, DataLink::kDefaultMaxFrameSize, 16);
+
+  const Packet header(4, 0x12), payload(300, 0x34);
+  const ConstBuffer segments[] = { { header.data(), header.size() }, { payload.data(), payload.size() } };
+  ASSERT_TRUE(link.sendFixedSizeFrame<304>(segments, 2));
+
+  std::vector<Packet> received;
+  const auto timeout = steady_clock::now() + seconds(2);
+  while(received.empty() && steady_clock::now() < timeout)
+  {
+    link.pollFramesUnBuffered(&received);
+  }
+
+  Packet expected(header);
+  expected.insert(expected.end(), payload.begin(), payload.end());
+  ASSERT_EQ(1, received.size());
+  EXPECT_EQ(expected, received[0]);
+}
+
+TEST(asctec_comm, datalink_frame_pool)
+{
+  std::shared_ptr<RawBuffer> loopback(new Loopback);
+  DataLink link(loopback);
+  FramePoolPtr pool = link.getFramePool();
+  const size_t available = pool->available();
+
+  Packet payload(100, 0x42);
+  std::vector<Packet> frames;
+  std::vector<const uint8_t*> buffers;
+
+  for(int i = 0; i < 10; ++i)
+  {
+    link.sendFrame(payload);
+    const auto timeout = steady_clock::now() + seconds(2);
+    do
+    {
+      link.pollFramesUnBuffered(&frames);
+    } while(frames.empty() && steady_clock::now() < timeout);
+
+    ASSERT_EQ(1, frames.size());
+    EXPECT_EQ(payload, frames[0]);
+    EXPECT_GE(frames[0].capacity(), pool->getFrameCapacity());
+    buffers.push_back(frames[0].data());
+  }
+
+  // the buffer of the previous poll is handed back and picked up again by the next frame
+  for(auto buffer : buffers)
+  {
+    EXPECT_EQ(buffers.front(), buffer);
+  }
+
+  link.pollFramesUnBuffered(&frames);
+  EXPECT_TRUE(frames.empty());
+  EXPECT_EQ(available, pool->available());
+}
+
+class LossyLoopback : public Loopback
+{
+public:
+  bool drop_ = false;
+
+  virtual int writeBuffer(uint8_t* data, int size)
+  {
+    return drop_ ? size : Loopback::writeBuffer(data, size);
+  }
+};
+
+TEST(asctec_comm, datalink_statistics)
+{
+  std::shared_ptr<LossyLoopback> loopback(new LossyLoopback);
+  DataLink link(loopback);
+
+  Packet payload(20, 0x42);
+  std::vector<Packet> frames;
+  size_t nReceived = 0;
+
+  auto receive = [&](size_t n)
+  {
+    const auto timeout = steady_clock::now() + seconds(2);
+    while(nReceived < n && steady_clock::now() < timeout)
+    {
+      link.pollFramesUnBuffered(&frames);
+      nReceived += frames.size();
+    }
+  };
+
+  link.sendFrame(payload);
+  receive(1);
+
+  // two frames vanish on the way
+  loopback->drop_ = true;
+  const uint64_t bytesBeforeDrop = link.getStatistics().bytesSent;
+  link.sendFrame(payload);
+  link.sendFrame(payload);
+  const uint64_t bytesDropped = link.getStatistics().bytesSent - bytesBeforeDrop;
+  loopback->drop_ = false;
+
+  link.sendFrame(payload);
+  receive(2);
+
+  // valid encoding, but the checksum does not match
+  uint8_t corrupted[] = { 0x06, 1, 2, 3, 4, 5, 0 };
+  loopback->writeBuffer(corrupted, sizeof(corrupted));
+  link.sendFrame(payload);
+  receive(3);
+
+  const LinkStatistics statistics = link.getStatistics();
+  EXPECT_EQ(5, statistics.framesSent);
+  EXPECT_EQ(0, statistics.framesSentSkipped);
+  EXPECT_EQ(3, statistics.framesReceived);
+  EXPECT_EQ(1, statistics.framesReceivedCrcError);
+  EXPECT_EQ(0, statistics.framesReceivedMalformed);
+  EXPECT_EQ(0, statistics.framesReceivedOverflow);
+  EXPECT_EQ(1, statistics.sequenceGaps);
+  EXPECT_EQ(2, statistics.framesLost);
+  EXPECT_EQ(statistics.bytesSent - bytesDropped + sizeof(corrupted), statistics.bytesReceived);
+}
+
+// Takes at most maxWrite_ bytes per write, like a nonblocking file descriptor of a slow link.
+class ThrottledLoopback : public Loopback
+{
+public:
+  int maxWrite_ = 7;
+
+  virtual int writeBuffer(uint8_t* data, int size)
+  {
+    if(maxWrite_ == 0)
+    {
+      return -1;
+    }
+    return Loopback::writeBuffer(data, std::min(size, maxWrite_));
+  }
+};
+
+TEST(asctec_comm, datalink_partial_writes)
+{
+  std::shared_ptr<ThrottledLoopback> loopback(new ThrottledLoopback);
+  DataLink link(loopback);
+
+  std::vector<Packet> sent;
+  for(int i = 0; i < 20; ++i)
+  {
+    sent.push_back(Packet(30, i));
+  }
+
+  // every frame needs several writes, nothing may be accepted while the tail of the previous one is pending
+  size_t nAccepted = 0;
+  const auto timeout = steady_clock::now() + seconds(2);
+  while(nAccepted < sent.size() && steady_clock::now() < timeout)
+  {
+    if(link.sendFrame(sent[nAccepted]))
+    {
+      ++nAccepted;
+    }
+  }
+  ASSERT_EQ(sent.size(), nAccepted);
+  while(!link.flush())
+  {
+  }
+  EXPECT_LT(0, link.getStatistics().partialWrites);
+
+  // a link that takes nothing at all
+  loopback->maxWrite_ = 0;
+  EXPECT_TRUE(link.sendFrame(sent[0]));
+  EXPECT_FALSE(link.sendFrame(sent[1]));
+  EXPECT_FALSE(link.flush());
+  loopback->maxWrite_ = 1000;
+  EXPECT_TRUE(link.flush());
+  sent.push_back(sent[0]);
+
+  std::vector<Packet> received, frames;
+  while(received.size() < sent.size() && steady_clock::now() < timeout)
+  {
+    link.pollFramesUnBuffered(&frames);
+    received.insert(received.end(), frames.begin(), frames.end());
+  }
+
+  EXPECT_EQ(sent, received);
+  EXPECT_EQ(0, link.getStatistics().framesLost);
+}
+
+TEST(asctec_comm, datalink_poll_frames)
+{
+  std::shared_ptr<RawBuffer> loopback(new Loopback);
+  DataLink link(loopback);
+
+  const Packet first(10, 1), second(300, 2);
+  link.sendFrame(first);
+  link.sendFrame(second);
+
+  std::vector<Packet> received;
+  const DataLink::FrameVisitor visitor = [&received](const uint8_t* data, size_t size, steady_clock::time_point)
+  {
+    received.push_back(Packet(data, data + size));
+  };
+
+  const auto timeout = steady_clock::now() + seconds(2);
+  while(received.size() < 2 && steady_clock::now() < timeout)
+  {
+    link.pollFrames(visitor);
+  }
+
+  ASSERT_EQ(2, received.size());
+  EXPECT_EQ(first, received[0]);
+  EXPECT_EQ(second, received[1]);
 }
 
 int main(int argc, char **argv)
@@ -165,7 +524,7 @@ int main(int argc, char **argv)
   //  uart->connect("/dev/ttyUSB0", 460800);
   //  comm = uart;
 
-  transport.reset(new DataLink(comm, 10, 10));
+  transport.reset(new DataLink(comm));
 
   return RUN_ALL_TESTS();
 }
@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2017 Intel Deutschland GmbH, Germany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <stdlib.h>
+
+#include <gtest/gtest.h>
+
+#include <asctec_comm/cobs.h>
+#include <asctec_comm/delta.h>
+#include <asctec_comm/types.h>
+
+using namespace asctec_comm;
+
+// slowly changing telemetry, a counter and a few noisy bytes
+static ByteVector makeMessage(int i)
+{
+  ByteVector message(64, 0x55);
+  message[0] = i;
+  message[1] = i >> 8;
+  message[10] = rand();
+  message[11] = rand();
+  return message;
+}
+
+TEST(asctec_comm, delta_roundtrip)
+{
+  srand(123456);
+  delta::Encoder encoder;
+  delta::Decoder decoder;
+  constexpr unsigned int keyframeInterval = 10;
+  encoder.setKeyframeInterval(1, keyframeInterval);
+
+  size_t plainSize = 0, deltaSize = 0;
+  for(int i = 0; i < 100; ++i)
+  {
+    const ByteVector message = makeMessage(i);
+    ByteVector payload = message;
+    uint16_t flags, seq;
+    ASSERT_TRUE(encoder.encode(1, &payload, &flags, &seq));
+    EXPECT_EQ(i, seq);
+    EXPECT_EQ(i % keyframeInterval == 0 ? delta::FLAG_KEYFRAME : delta::FLAG_DELTA, flags);
+
+    ByteVector decoded;
+    ASSERT_TRUE(decoder.decode(1, flags, seq, payload.data(), payload.size(), &decoded));
+    EXPECT_EQ(message, decoded);
+
+    uint8_t encoded[cobs::Encoder::getMaxEncodedSize(64)];
+    plainSize += cobs::encode(message.data(), message.size(), encoded, sizeof(encoded));
+    deltaSize += cobs::encode(payload.data(), payload.size(), encoded, sizeof(encoded));
+  }
+
+  std::cout << "COBS encoded size plain: " << plainSize << " delta: " << deltaSize << std::endl;
+  EXPECT_LT(deltaSize * 2, plainSize);
+
+  // not enabled for other ids
+  ByteVector payload = makeMessage(0);
+  uint16_t flags, seq;
+  EXPECT_FALSE(encoder.encode(2, &payload, &flags, &seq));
+}
+
+TEST(asctec_comm, delta_resync_after_loss)
+{
+  srand(123456);
+  delta::Encoder encoder;
+  delta::Decoder decoder;
+  encoder.setKeyframeInterval(1, 5);
+
+  for(int i = 0; i < 20; ++i)
+  {
+    const ByteVector message = makeMessage(i);
+    ByteVector payload = message;
+    uint16_t flags, seq;
+    ASSERT_TRUE(encoder.encode(1, &payload, &flags, &seq));
+
+    // message 7 gets lost, deltas are undecodable until the keyframe at 10
+    if(i == 7)
+    {
+      continue;
+    }
+
+    ByteVector decoded;
+    const bool success = decoder.decode(1, flags, seq, payload.data(), payload.size(), &decoded);
+    EXPECT_EQ(i < 7 || i >= 10, success) << " message " << i;
+    if(success)
+    {
+      EXPECT_EQ(message, decoded);
+    }
+  }
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,219 @@
+/*
+ * Copyright (C) 2017 Intel Deutschland GmbH, Germany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <chrono>
+#include <random>
+
+#include <gtest/gtest.h>
+
+#include <asctec_comm/cobs.h>
+#include <asctec_comm/datalink.h>
+#include <asctec_comm/fec.h>
+#include <asctec_comm/macros.h>
+
+#include "loopback.h"
+
+using namespace asctec_comm;
+using namespace std::chrono;
+
+// Flips bytes of the frames written, but leaves the framing intact, like bit errors hitting the payload.
+class NoisyLoopback : public Loopback
+{
+public:
+  NoisyLoopback(size_t nErrors)
+      : nErrors_(nErrors), generator_(123456)
+  {
+  }
+
+  virtual int writeBuffer(uint8_t* data, int size)
+  {
+    ByteVector noisy;
+    const uint8_t* end = data + size;
+    while(data < end)
+    {
+      const size_t n = cobs::findZero(data, end - data);
+
+      ByteVector frame(n), encoded(cobs::Encoder::getMaxEncodedSize(n) + 1);
+      size_t frameSize;
+      cobs::decode(data, n, frame.data(), frame.size(), &frameSize);
+
+      // different positions, so exactly nErrors_ bytes differ
+      for(size_t i = 0; i < nErrors_ && i < frameSize; ++i)
+      {
+        frame[(i * frameSize) / nErrors_] ^= std::uniform_int_distribution<int>(1, 255)(generator_);
+      }
+
+      const size_t encodedSize = cobs::encode(frame.data(), frameSize, encoded.data(), encoded.size());
+      noisy.insert(noisy.end(), encoded.begin(), encoded.begin() + encodedSize);
+      noisy.push_back(0);
+      data += n + 1;
+    }
+
+    Loopback::writeBuffer(noisy.data(), noisy.size());
+    return size;
+  }
+
+private:
+  size_t nErrors_;
+  std::mt19937 generator_;
+};
+
+TEST(asctec_comm, fec_reed_solomon)
+{
+  std::mt19937 generator(123456);
+  std::uniform_int_distribution<int> byte(0, 255);
+
+  for(size_t nParity : { 2, 8, 16, 32 })
+  {
+    fec::ReedSolomon rs(nParity);
+
+    for(int run = 0; run < 200; ++run)
+    {
+      ByteVector data(std::uniform_int_distribution<int>(1, 2000)(generator));
+      for(auto& c : data)
+      {
+        c = byte(generator);
+      }
+
+      ByteVector encoded(rs.getEncodedSize(data.size()));
+      ASSERT_EQ(encoded.size(), rs.encode(data.data(), data.size(), encoded.data()));
+
+      // the maximum number of repairable errors in every block
+      size_t nErrors = 0;
+      for(size_t block = 0; block < encoded.size(); block += fec::ReedSolomon::kMaxBlockSize)
+      {
+        const size_t blockSize = std::min(fec::ReedSolomon::kMaxBlockSize, encoded.size() - block);
+        for(size_t i = 0; i < nParity / 2; ++i)
+        {
+          encoded[block + (i * blockSize) / (nParity / 2)] ^= std::uniform_int_distribution<int>(1, 255)(generator);
+          ++nErrors;
+        }
+      }
+
+      size_t decodedSize, nCorrected;
+      ASSERT_TRUE(rs.decode(encoded.data(), encoded.size(), &decodedSize, &nCorrected));
+      EXPECT_EQ(nErrors, nCorrected);
+      ASSERT_EQ(data.size(), decodedSize);
+      EXPECT_TRUE(std::equal(data.begin(), data.end(), encoded.begin()));
+    }
+  }
+}
+
+TEST(asctec_comm, fec_datalink_repairs_frames)
+{
+  std::shared_ptr<RawBuffer> loopback(new NoisyLoopback(3));
+  DataLink link(loopback, DataLink::kDefaultMaxFrameSize, 8);
+
+  ByteVector frame(500);
+  for(size_t i = 0; i < frame.size(); ++i)
+  {
+    frame[i] = i;
+  }
+
+  constexpr size_t nFrames = 20;
+  for(size_t i = 0; i < nFrames; ++i)
+  {
+    link.sendFrame(frame);
+  }
+
+  std::vector<ByteVector> received, frames;
+  const auto timeout = steady_clock::now() + seconds(2);
+  while(received.size() < nFrames && steady_clock::now() < timeout)
+  {
+    link.pollFramesUnBuffered(&frames);
+    received.insert(received.end(), frames.begin(), frames.end());
+  }
+
+  ASSERT_EQ(nFrames, received.size());
+  for(auto& r : received)
+  {
+    EXPECT_EQ(frame, r);
+  }
+
+  const LinkStatistics statistics = link.getStatistics();
+  EXPECT_EQ(nFrames, statistics.framesReceivedRepaired);
+  EXPECT_EQ(3 * nFrames, statistics.bytesRepaired);
+  EXPECT_EQ(0, statistics.framesReceivedCrcError);
+
+  // without forward error correction every frame is lost
+  std::shared_ptr<RawBuffer> noisy(new NoisyLoopback(1));
+  DataLink plain(noisy);
+  plain.sendFrame(frame);
+  for(int i = 0; i < 10 && plain.getStatistics().bytesReceived == 0; ++i)
+  {
+    plain.pollFramesUnBuffered(&frames);
+  }
+  EXPECT_TRUE(frames.empty());
+  EXPECT_EQ(1, plain.getStatistics().framesReceivedCrcError);
+}
+
+TEST(asctec_comm, fec_benchmark)
+{
+  std::mt19937 generator(123456);
+  std::uniform_int_distribution<int> byte(0, 255);
+  constexpr size_t kSize = 1024;
+  constexpr int kRuns = 2000;
+
+  ByteVector data(kSize);
+  for(auto& c : data)
+  {
+    c = byte(generator);
+  }
+
+  for(size_t nParity : { 4, 8, 16, 32 })
+  {
+    fec::ReedSolomon rs(nParity);
+    ByteVector encoded(rs.getEncodedSize(kSize)), noisy(encoded.size());
+
+    auto start = steady_clock::now();
+    for(int run = 0; run < kRuns; ++run)
+    {
+      rs.encode(data.data(), data.size(), encoded.data());
+    }
+    const double encodeTime = duration_cast<duration<double, std::micro>>(steady_clock::now() - start).count() / kRuns;
+
+    // clean blocks only need the syndromes, blocks with errors the full decoder
+    double decodeTime[2];
+    for(int withErrors = 0; withErrors < 2; ++withErrors)
+    {
+      start = steady_clock::now();
+      for(int run = 0; run < kRuns; ++run)
+      {
+        noisy = encoded;
+        if(withErrors)
+        {
+          for(size_t block = 0; block < noisy.size(); block += fec::ReedSolomon::kMaxBlockSize)
+          {
+            noisy[block] ^= 0x5a;
+          }
+        }
+        size_t decodedSize;
+        rs.decode(noisy.data(), noisy.size(), &decodedSize, nullptr);
+      }
+      decodeTime[withErrors] = duration_cast<duration<double, std::micro>>(steady_clock::now() - start).count() / kRuns;
+    }
+
+    ASCTEC_INFO_STREAM("fec " << nParity << " parity bytes per block: encode " << encodeTime << " us/KB, decode "
+        << decodeTime[0] << " us/KB, decode with errors " << decodeTime[1] << " us/KB, overhead "
+        << (encoded.size() - kSize) * 100 / kSize << "%");
+  }
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
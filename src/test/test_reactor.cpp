@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2017 Intel Deutschland GmbH, Germany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <chrono>
+#include <thread>
+
+#include <errno.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include <asctec_comm/datalink.h>
+#include <asctec_comm/reactor.h>
+#include <asctec_comm/transport.h>
+
+using namespace asctec_comm;
+using namespace std::chrono;
+
+namespace
+{
+
+// One end of a socket pair, stands in for a serial port.
+class SocketLink : public RawBuffer
+{
+public:
+  explicit SocketLink(int fd)
+      : fd_(fd)
+  {
+  }
+
+  virtual ~SocketLink()
+  {
+    ::close(fd_);
+  }
+
+  virtual int writeBuffer(uint8_t* data, int size)
+  {
+    const int result = ::send(fd_, data, size, MSG_DONTWAIT);
+    return result < 0 && errno == EAGAIN ? 0 : result;
+  }
+
+  virtual int readBuffer(uint8_t* data, int size)
+  {
+    const int result = ::recv(fd_, data, size, MSG_DONTWAIT);
+    return result < 0 && errno == EAGAIN ? 0 : result;
+  }
+
+  virtual int getFileDescriptor() const
+  {
+    return fd_;
+  }
+
+private:
+  int fd_;
+};
+
+}
+
+TEST(asctec_comm, reactor)
+{
+  int fds[2];
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+  SocketLink a(fds[0]), b(fds[1]);
+
+  Reactor reactor(b.getFileDescriptor());
+  ASSERT_TRUE(reactor.isValid());
+
+  // timeout
+  steady_clock::time_point start = steady_clock::now();
+  EXPECT_FALSE(reactor.wait(milliseconds(20)));
+  EXPECT_LE(milliseconds(20), steady_clock::now() - start);
+
+  // a wakeup before the wait is not lost
+  reactor.wakeup();
+  EXPECT_FALSE(reactor.wait(milliseconds(1000)));
+
+  // data arrives while waiting
+  std::thread writer([&a]()
+  {
+    std::this_thread::sleep_for(milliseconds(20));
+    uint8_t c = 0x42;
+    a.writeBuffer(&c, 1);
+  });
+  start = steady_clock::now();
+  EXPECT_TRUE(reactor.wait(milliseconds(1000)));
+  EXPECT_GT(milliseconds(500), steady_clock::now() - start);
+  writer.join();
+
+  // level triggered, stays readable until read
+  EXPECT_TRUE(reactor.wait(milliseconds(0)));
+  uint8_t c;
+  EXPECT_EQ(1, b.readBuffer(&c, 1));
+  EXPECT_FALSE(reactor.wait(milliseconds(0)));
+
+  // without a file descriptor the caller has to poll
+  Reactor invalid(-1);
+  EXPECT_FALSE(invalid.isValid());
+}
+
+TEST(asctec_comm, transport_reactor)
+{
+  int fds[2];
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+  std::shared_ptr<DataLink> dataLinkA(new DataLink(std::make_shared<SocketLink>(fds[0])));
+  std::shared_ptr<DataLink> dataLinkB(new DataLink(std::make_shared<SocketLink>(fds[1])));
+
+  steady_clock::time_point start;
+  {
+    Transport transportA(dataLinkA), transportB(dataLinkB);
+
+    ByteVector data = { 1, 2, 3, 4 };
+    ASSERT_TRUE(transportA.sendData(1, data));
+
+    uint32_t id;
+    ByteVector received;
+    ASSERT_TRUE(transportB.waitForData(milliseconds(1000), &id, &received));
+    EXPECT_EQ(1u, id);
+    EXPECT_EQ(data, received);
+
+    EXPECT_TRUE(transportA.sendDataAcknowledged(milliseconds(1000), 2, data));
+
+    // the destructor must not wait for the receive thread to time out
+    start = steady_clock::now();
+  }
+  EXPECT_GT(milliseconds(500), steady_clock::now() - start);
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
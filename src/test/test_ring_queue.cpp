@@ -0,0 +1,216 @@
+/*
+ * Copyright (C) 2017 Intel Deutschland GmbH, Germany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <asctec_comm/macros.h>
+#include <asctec_comm/ring_queue.h>
+#include <asctec_comm/thread_safe_queue.h>
+
+using namespace asctec_comm;
+using namespace std::chrono;
+
+TEST(asctec_comm, ring_queue)
+{
+  RingQueue<std::unique_ptr<int>> queue(3);
+  EXPECT_TRUE(queue.empty());
+
+  for(int i = 0; i < 3; ++i)
+  {
+    EXPECT_TRUE(queue.tryPush(std::unique_ptr<int>(new int(i))));
+  }
+  EXPECT_EQ(3, queue.size());
+
+  // full, the element stays with the caller
+  std::unique_ptr<int> item(new int(3));
+  EXPECT_FALSE(queue.tryPush(std::move(item)));
+  ASSERT_TRUE(item != nullptr);
+
+  // push makes room by discarding the oldest
+  queue.push(std::move(item));
+
+  // wraps around several times
+  for(int i = 1; i < 20; ++i)
+  {
+    ASSERT_TRUE(queue.tryPop(&item));
+    EXPECT_EQ(i, *item);
+    EXPECT_TRUE(queue.tryPush(std::unique_ptr<int>(new int(i + 3))));
+  }
+
+  const steady_clock::time_point start = steady_clock::now();
+  int n = 0;
+  while(queue.popWithTimeout(milliseconds(20), &item))
+  {
+    ++n;
+  }
+  EXPECT_EQ(3, n);
+  EXPECT_LE(milliseconds(20), steady_clock::now() - start);
+}
+
+namespace
+{
+
+struct Item
+{
+  int producer;
+  int seq;
+  steady_clock::time_point timeSent;
+};
+
+struct Result
+{
+  double itemsPerSecond;
+  double meanLatencyUs;
+};
+
+// "nProducers" threads push as fast as the queue takes it, one consumer checks the order of each producer.
+template<class Queue>
+Result runContention(Queue* queue, int nProducers, int nItems)
+{
+  std::vector<std::thread> producers;
+  const steady_clock::time_point start = steady_clock::now();
+
+  for(int p = 0; p < nProducers; ++p)
+  {
+    producers.emplace_back([queue, p, nItems]()
+    {
+      for(int i = 0; i < nItems; ++i)
+      {
+        Item item { p, i, steady_clock::now() };
+        while(!queue->tryPush(std::move(item)))
+        {
+          std::this_thread::yield();
+          item.timeSent = steady_clock::now();
+        }
+      }
+    });
+  }
+
+  std::vector<int> next(nProducers, 0);
+  double latency = 0;
+  for(int i = 0; i < nProducers * nItems; ++i)
+  {
+    Item item;
+    EXPECT_TRUE(queue->popWithTimeout(milliseconds(1000), &item));
+    EXPECT_EQ(next[item.producer], item.seq);
+    next[item.producer] = item.seq + 1;
+    latency += duration_cast<duration<double, std::micro>>(steady_clock::now() - item.timeSent).count();
+  }
+
+  const double seconds = duration_cast<duration<double>>(steady_clock::now() - start).count();
+  for(auto& producer : producers)
+  {
+    producer.join();
+  }
+
+  return Result { nProducers * nItems / seconds, latency / (nProducers * nItems) };
+}
+
+// One item at a time, the consumer sleeps in between, like commands sent at a fixed rate.
+template<class Queue>
+double runWakeupLatency(Queue* queue, int nItems)
+{
+  std::thread producer([queue, nItems]()
+  {
+    for(int i = 0; i < nItems; ++i)
+    {
+      std::this_thread::sleep_for(microseconds(500));
+      queue->tryPush(Item { 0, i, steady_clock::now() });
+    }
+  });
+
+  double latency = 0;
+  for(int i = 0; i < nItems; ++i)
+  {
+    Item item;
+    EXPECT_TRUE(queue->popWithTimeout(milliseconds(1000), &item));
+    latency += duration_cast<duration<double, std::micro>>(steady_clock::now() - item.timeSent).count();
+  }
+  producer.join();
+
+  return latency / nItems;
+}
+
+}
+
+// Numbers for comparison with ThreadSafeQueue, not a pass/fail criterion.
+TEST(asctec_comm, ring_queue_interrupt)
+{
+  RingQueue<int> queue(3);
+  int item;
+
+  // an interrupt before the wait is not lost, it is used up by one wait
+  queue.interrupt();
+  steady_clock::time_point start = steady_clock::now();
+  EXPECT_FALSE(queue.popWithTimeout(seconds(1), &item));
+  EXPECT_GT(milliseconds(100), steady_clock::now() - start);
+
+  start = steady_clock::now();
+  EXPECT_FALSE(queue.popWithTimeout(milliseconds(20), &item));
+  EXPECT_LE(milliseconds(20), steady_clock::now() - start);
+
+  // wakes up a sleeping consumer
+  std::thread interrupter([&queue]()
+  {
+    std::this_thread::sleep_for(milliseconds(20));
+    queue.interrupt();
+  });
+  start = steady_clock::now();
+  EXPECT_FALSE(queue.popWithTimeout(seconds(1), &item));
+  EXPECT_GT(milliseconds(500), steady_clock::now() - start);
+  interrupter.join();
+
+  // data still wins over a pending interrupt
+  queue.interrupt();
+  EXPECT_TRUE(queue.tryPush(1));
+  EXPECT_TRUE(queue.popWithTimeout(seconds(1), &item));
+  EXPECT_EQ(1, item);
+}
+
+TEST(asctec_comm, ring_queue_benchmark)
+{
+  constexpr int nItems = 20000;
+  constexpr int nWakeups = 200;
+
+  for(int nProducers : { 1, 4 })
+  {
+    RingQueue<Item> ringQueue(128);
+    ThreadSafeQueue<Item> threadSafeQueue(128);
+
+    const Result ring = runContention(&ringQueue, nProducers, nItems);
+    const Result locked = runContention(&threadSafeQueue, nProducers, nItems);
+
+    ASCTEC_INFO_STREAM(nProducers << " producers: RingQueue " << ring.itemsPerSecond / 1e6 << " M items/s, "
+        << ring.meanLatencyUs << " us latency; ThreadSafeQueue " << locked.itemsPerSecond / 1e6 << " M items/s, "
+        << locked.meanLatencyUs << " us latency");
+  }
+
+  RingQueue<Item> ringQueue(128);
+  ThreadSafeQueue<Item> threadSafeQueue(128);
+  const double ring = runWakeupLatency(&ringQueue, nWakeups);
+  const double locked = runWakeupLatency(&threadSafeQueue, nWakeups);
+  ASCTEC_INFO_STREAM("wakeup latency: RingQueue " << ring << " us, ThreadSafeQueue " << locked << " us");
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
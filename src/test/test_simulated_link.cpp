@@ -0,0 +1,249 @@
+/*
+ * Copyright (C) 2017 Intel Deutschland GmbH, Germany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <chrono>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include <asctec_comm/datalink.h>
+#include <asctec_comm/macros.h>
+#include <asctec_comm/simulated_link.h>
+#include <asctec_comm/transport.h>
+
+using namespace asctec_comm;
+using namespace std::chrono;
+
+TEST(asctec_comm, simulated_link_timing)
+{
+  SimulatedLinkParameters parameters;
+  parameters.baudRate = 115200;
+  parameters.latency = milliseconds(20);
+  SimulatedLinkPtr a, b;
+  SimulatedLink::createPair(parameters, &a, &b);
+
+  // 1000 bytes take 87 ms on the line
+  ByteVector data(1000, 0x42);
+  const steady_clock::time_point start = steady_clock::now();
+  ASSERT_EQ(data.size(), a->writeBuffer(data.data(), data.size()));
+
+  uint8_t buffer[100];
+  int first = 0;
+  while(first == 0)
+  {
+    first = b->readBuffer(buffer, sizeof(buffer));
+  }
+  const double firstArrival = duration_cast<duration<double>>(steady_clock::now() - start).count();
+
+  size_t received = first;
+  while(received < data.size())
+  {
+    received += b->readBuffer(buffer, sizeof(buffer));
+  }
+  const double lastArrival = duration_cast<duration<double>>(steady_clock::now() - start).count();
+
+  EXPECT_NEAR(0.020, firstArrival, 0.005);
+  EXPECT_NEAR(0.020 + 1000 * 10.0 / 115200, lastArrival, 0.005);
+
+  // the other direction is independent
+  EXPECT_EQ(0, a->readBuffer(buffer, sizeof(buffer)));
+}
+
+TEST(asctec_comm, simulated_link_fifo)
+{
+  SimulatedLinkParameters parameters;
+  parameters.baudRate = 9600;
+  parameters.txFifoSize = 100;
+  SimulatedLinkPtr a, b;
+  SimulatedLink::createPair(parameters, &a, &b);
+
+  ByteVector data(150, 0x42);
+  EXPECT_EQ(100, a->writeBuffer(data.data(), data.size()));
+  EXPECT_EQ(0, a->writeBuffer(data.data(), data.size()));
+
+  // a few bytes have left the FIFO after 10 ms
+  std::this_thread::sleep_for(milliseconds(10));
+  EXPECT_LT(0, a->writeBuffer(data.data(), data.size()));
+}
+
+TEST(asctec_comm, simulated_link_errors)
+{
+  SimulatedLinkParameters parameters;
+  parameters.baudRate = 10000000;
+  parameters.byteDropRate = 0.01;
+  parameters.bitErrorRate = 0.001;
+  parameters.txFifoSize = 10000;
+  parameters.seed = 42;
+
+  SimulatedLinkStatistics statistics[2];
+  for(auto& s : statistics)
+  {
+    SimulatedLinkPtr a, b;
+    SimulatedLink::createPair(parameters, &a, &b);
+    ByteVector data(10000, 0x00);
+    ASSERT_EQ(data.size(), a->writeBuffer(data.data(), data.size()));
+    s = a->getTxStatistics();
+  }
+
+  EXPECT_NEAR(100, statistics[0].bytesDropped, 40);
+  EXPECT_NEAR(80, statistics[0].bytesCorrupted, 40);
+
+  // same seed, same errors
+  EXPECT_EQ(statistics[0].bytesDropped, statistics[1].bytesDropped);
+  EXPECT_EQ(statistics[0].bytesCorrupted, statistics[1].bytesCorrupted);
+}
+
+// Numbers for a typical telemetry radio, not a pass/fail criterion.
+TEST(asctec_comm, simulated_link_benchmark)
+{
+  SimulatedLinkParameters parameters;
+  parameters.baudRate = 57600;
+  parameters.latency = milliseconds(5);
+  parameters.bitErrorRate = 1e-5;
+  SimulatedLinkPtr a, b;
+  SimulatedLink::createPair(parameters, &a, &b);
+
+  std::shared_ptr<DataLink> dataLinkA(new DataLink(a)), dataLinkB(new DataLink(b));
+  Transport transportA(dataLinkA), transportB(dataLinkB);
+
+  // throughput, the sender keeps the queue full for a second
+  ByteVector payload(100, 0x42);
+  const steady_clock::time_point start = steady_clock::now();
+  size_t nReceived = 0;
+  while(steady_clock::now() - start < seconds(1))
+  {
+    while(transportA.getSendQueueSize() < 10 && transportA.sendData(1, payload))
+    {
+    }
+
+    uint32_t id;
+    ByteVector datagram;
+    while(transportB.waitForData(milliseconds(0), &id, &datagram))
+    {
+      ++nReceived;
+    }
+    std::this_thread::sleep_for(milliseconds(1));
+  }
+  const double throughput = nReceived * payload.size() / duration_cast<duration<double>>(steady_clock::now() - start).count();
+
+  // ack round trip time
+  constexpr int nAcks = 10;
+  int nAcked = 0;
+  // let the send queue, the frames held back by the send thread and the UART FIFO drain first
+  uint64_t bytesSent;
+  do
+  {
+    bytesSent = dataLinkA->getStatistics().bytesSent;
+    std::this_thread::sleep_for(milliseconds(100));
+  } while(dataLinkA->getStatistics().bytesSent != bytesSent);
+  std::this_thread::sleep_for(milliseconds(parameters.txFifoSize * 10000 / parameters.baudRate));
+
+  const steady_clock::time_point ackStart = steady_clock::now();
+  for(int i = 0; i < nAcks; ++i)
+  {
+    nAcked += transportA.sendDataAcknowledged(milliseconds(500), 2, payload);
+  }
+  const double rtt = duration_cast<duration<double, std::milli>>(steady_clock::now() - ackStart).count() / nAcks;
+
+  ASCTEC_INFO_STREAM("57600 baud: goodput " << throughput << " B/s (line rate " << parameters.baudRate / 10
+      << " B/s), ack round trip " << rtt << " ms, " << nAcked << "/" << nAcks << " acked");
+
+  EXPECT_LT(0.5 * parameters.baudRate / 10, throughput);
+  EXPECT_GT(parameters.baudRate / 10, throughput);
+}
+
+// Reliable configuration at startup, one message after the other versus all in flight at once.
+TEST(asctec_comm, simulated_link_pipelined_acks)
+{
+  SimulatedLinkParameters parameters;
+  parameters.baudRate = 921600;
+  parameters.latency = milliseconds(20);
+  SimulatedLinkPtr a, b;
+  SimulatedLink::createPair(parameters, &a, &b);
+
+  Transport transportA(std::make_shared<DataLink>(a)), transportB(std::make_shared<DataLink>(b));
+
+  constexpr int nMessages = 10;
+  const ByteVector payload(20, 0x42);
+
+  steady_clock::time_point start = steady_clock::now();
+  for(int i = 0; i < nMessages; ++i)
+  {
+    EXPECT_TRUE(transportA.sendDataAcknowledged(milliseconds(500), 1, payload));
+  }
+  const double blocking = duration_cast<duration<double, std::milli>>(steady_clock::now() - start).count();
+
+  start = steady_clock::now();
+  std::vector<std::future<bool>> futures;
+  for(int i = 0; i < nMessages; ++i)
+  {
+    futures.push_back(transportA.sendDataAcknowledgedAsync(milliseconds(500), 1, payload));
+  }
+  for(auto& future : futures)
+  {
+    EXPECT_TRUE(future.get());
+  }
+  const double pipelined = duration_cast<duration<double, std::milli>>(steady_clock::now() - start).count();
+
+  ASCTEC_INFO_STREAM(nMessages << " acknowledged messages with 40 ms round trip: " << blocking << " ms blocking, "
+      << pipelined << " ms pipelined");
+  EXPECT_GT(blocking / 3, pipelined);
+}
+
+// Lost messages or acks are recovered after about one retransmission timeout instead of the caller's timeout.
+TEST(asctec_comm, simulated_link_retransmission)
+{
+  SimulatedLinkParameters parameters;
+  parameters.baudRate = 921600;
+  parameters.latency = milliseconds(10);
+  parameters.byteDropRate = 0.003;
+  parameters.seed = 1;
+  SimulatedLinkPtr a, b;
+  SimulatedLink::createPair(parameters, &a, &b);
+
+  Transport transportA(std::make_shared<DataLink>(a)), transportB(std::make_shared<DataLink>(b));
+  RetransmissionPolicy policy;
+  policy.maxAttempts = 5;
+  transportA.setRetransmissionPolicy(policy);
+
+  constexpr int nMessages = 100;
+  const ByteVector payload(20, 0x42);
+  int nAcknowledged = 0;
+  double maxDuration = 0;
+  for(int i = 0; i < nMessages; ++i)
+  {
+    const steady_clock::time_point start = steady_clock::now();
+    nAcknowledged += transportA.sendDataAcknowledged(milliseconds(2000), 1, payload);
+    maxDuration = std::max(maxDuration, duration_cast<duration<double, std::milli>>(steady_clock::now() - start).count());
+  }
+
+  const AckStatistics statistics = transportA.getAckStatistics();
+  ASCTEC_INFO_STREAM(nAcknowledged << "/" << nMessages << " acknowledged, " << statistics.retransmissions
+      << " retransmissions, SRTT " << statistics.smoothedRtt.count() << " us, RTTVAR "
+      << statistics.rttVariation.count() << " us, RTO " << statistics.retransmissionTimeout.count()
+      << " us, slowest " << maxDuration << " ms");
+
+  EXPECT_EQ(nMessages, nAcknowledged);
+  EXPECT_LT(0, statistics.retransmissions);
+  EXPECT_NEAR(20000, statistics.smoothedRtt.count(), 10000);
+  EXPECT_GT(1000, maxDuration);
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
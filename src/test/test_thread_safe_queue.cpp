@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2017 Intel Deutschland GmbH, Germany
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <memory>
+
+#include <gtest/gtest.h>
+
+#include <asctec_comm/thread_safe_queue.h>
+#include <asctec_comm/types.h>
+
+using namespace asctec_comm;
+using namespace std::chrono;
+
+TEST(asctec_comm, thread_safe_queue_move_only)
+{
+  ThreadSafeQueue<std::unique_ptr<int>> queue(2);
+
+  queue.push(std::unique_ptr<int>(new int(1)));
+  queue.emplace(new int(2));
+
+  std::unique_ptr<int> item(new int(3));
+  EXPECT_FALSE(queue.tryPush(std::move(item)));
+  ASSERT_TRUE(item != nullptr);  // still owned by the caller
+
+  EXPECT_EQ(1, *queue.pop());
+  EXPECT_TRUE(queue.tryPush(std::move(item)));
+  EXPECT_TRUE(item == nullptr);
+
+  ASSERT_TRUE(queue.tryPop(&item));
+  EXPECT_EQ(2, *item);
+  ASSERT_TRUE(queue.popWithTimeout(milliseconds(10), &item));
+  EXPECT_EQ(3, *item);
+  EXPECT_TRUE(queue.empty());
+}
+
+TEST(asctec_comm, thread_safe_queue_no_payload_copies)
+{
+  ThreadSafeQueue<ByteVector> queue(10);
+
+  ByteVector data(100, 0x42);
+  const uint8_t* buffer = data.data();
+
+  queue.push(std::move(data));
+  ByteVector out;
+  ASSERT_TRUE(queue.tryPop(&out));
+
+  // the same allocation went through the queue
+  EXPECT_EQ(buffer, out.data());
+  EXPECT_EQ(100, out.size());
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
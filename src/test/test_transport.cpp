@@ -25,7 +25,7 @@
 
 #include "loopback.h"
 
-using namespace trinity_comm;
+using namespace asctec_comm;
 using namespace std::chrono;
 
 int nRuns = 100;
@@ -39,7 +39,7 @@ struct Data
   uint8_t payload[payloadSize];
 };
 
-TEST(trinity_comm, Transport_loopback_bridge)
+TEST(asctec_comm, Transport_loopback_bridge)
 {
   LoopbackBridge localBridge;
 
@@ -94,11 +94,11 @@ TEST(trinity_comm, Transport_loopback_bridge)
 class SendReceiveTest
 {
 public:
-  SendReceiveTest()
+  SendReceiveTest(size_t maxFrameSize = DataLink::kDefaultMaxFrameSize)
       : shutdown_(false)
   {
-    dlDevice_.reset(new DataLink(bridge_.rxTxLoopback_, 100, 100));
-    dlPc_.reset(new DataLink(bridge_.txRxLoopback_, 100, 100));
+    dlDevice_.reset(new DataLink(bridge_.rxTxLoopback_, maxFrameSize));
+    dlPc_.reset(new DataLink(bridge_.txRxLoopback_, maxFrameSize));
     device_.reset(new Transport(dlDevice_));
     pc_.reset(new Transport(dlPc_));
   }
@@ -109,7 +109,7 @@ public:
   bool shutdown_;
 };
 
-TEST(trinity_comm, Transport_test_ack)
+TEST(asctec_comm, Transport_test_ack)
 {
   SendReceiveTest test;
 
@@ -131,7 +131,145 @@ TEST(trinity_comm, Transport_test_ack)
   }
 }
 
-TEST(trinity_comm, Transport_test_ack_fun_with_threads)
+TEST(asctec_comm, Transport_ack_async)
+{
+  SendReceiveTest test;
+  test.pc_->setAckWindow(4);
+
+  // more messages than the window, the rest waits for earlier acks
+  std::atomic<int> nAcknowledged(0);
+  std::vector<std::future<bool>> futures;
+  for(int i = 0; i < 20; ++i)
+  {
+    ByteVector data(10, i);
+    test.pc_->sendDataAcknowledgedAsync(milliseconds(500), 1, data, [&nAcknowledged](bool acknowledged)
+    {
+      nAcknowledged += acknowledged;
+    });
+    futures.push_back(test.pc_->sendDataAcknowledgedAsync(milliseconds(500), 2, data));
+  }
+
+  for(auto& future : futures)
+  {
+    EXPECT_TRUE(future.get());
+  }
+  std::this_thread::sleep_for(milliseconds(10));
+  EXPECT_EQ(20, nAcknowledged);
+
+  AckStatistics statistics = test.pc_->getAckStatistics();
+  EXPECT_EQ(40, statistics.messagesSent);
+  EXPECT_EQ(40, statistics.messagesAcknowledged);
+  EXPECT_EQ(0, statistics.retransmissions);
+  EXPECT_LT(microseconds(0), statistics.smoothedRtt);
+
+  // nobody answers anymore, the message is sent again before the timeout
+  RetransmissionPolicy policy;
+  policy.maxAttempts = 10;
+  test.pc_->setRetransmissionPolicy(policy);
+  test.device_.reset();
+  const steady_clock::time_point start = steady_clock::now();
+  std::future<bool> future = test.pc_->sendDataAcknowledgedAsync(milliseconds(50), 1, ByteVector(10));
+  EXPECT_FALSE(future.get());
+  EXPECT_LE(milliseconds(50), steady_clock::now() - start);
+  EXPECT_GT(milliseconds(200), steady_clock::now() - start);
+
+  statistics = test.pc_->getAckStatistics();
+  EXPECT_LT(0, statistics.retransmissions);
+  EXPECT_EQ(1, statistics.messagesFailed);
+
+  // without retransmissions it gives up after the first timeout already
+  policy.maxAttempts = 1;
+  test.pc_->setRetransmissionPolicy(policy);
+  future = test.pc_->sendDataAcknowledgedAsync(milliseconds(1000), 1, ByteVector(10));
+  EXPECT_FALSE(future.get());
+  EXPECT_GT(milliseconds(500), steady_clock::now() - start);
+
+  // oversized messages fail right away
+  std::future<bool> oversized = test.pc_->sendDataAcknowledgedAsync(milliseconds(50), 1, ByteVector(10000));
+  ASSERT_EQ(std::future_status::ready, oversized.wait_for(milliseconds(0)));
+  EXPECT_FALSE(oversized.get());
+}
+
+TEST(asctec_comm, Transport_ack_backlog_limit)
+{
+  // nobody acknowledges, so everything beyond the window piles up in the backlog
+  LoopbackBridge bridge;
+  std::unique_ptr<Transport> transport(new Transport(std::make_shared<DataLink>(bridge.txRxLoopback_)));
+  transport->setAckWindow(1);
+
+  // past the limit, the backlog does not grow anymore
+  const size_t nMessages = Transport::kMaxAckBacklog + 100;
+  std::atomic<size_t> nCompleted(0), nFailed(0);
+  for(size_t i = 0; i < nMessages; ++i)
+  {
+    transport->sendDataAcknowledgedAsync(seconds(10), 1, ByteVector(4), [&](bool acknowledged)
+    {
+      ++nCompleted;
+      nFailed += !acknowledged;
+    });
+  }
+
+  // one in the window, the others beyond the backlog limit failed right away
+  EXPECT_EQ(nMessages - 1 - Transport::kMaxAckBacklog, nCompleted);
+  EXPECT_EQ(nCompleted, nFailed);
+
+  // the rest is failed exactly once on shutdown
+  transport.reset();
+  EXPECT_EQ(nMessages, nCompleted);
+  EXPECT_EQ(nMessages, nFailed);
+}
+
+// Writes nothing while "blocked_" is set, so frames pile up in the send queue of the transport.
+class BlockingBuffer : public RawBuffer
+{
+public:
+  BlockingBuffer(RawBufferPtr rawBuffer)
+      : blocked_(true), rawBuffer_(rawBuffer)
+  {
+  }
+
+  virtual int writeBuffer(uint8_t* data, int size)
+  {
+    return blocked_ ? 0 : rawBuffer_->writeBuffer(data, size);
+  }
+
+  virtual int readBuffer(uint8_t* data, int size)
+  {
+    return rawBuffer_->readBuffer(data, size);
+  }
+
+  std::atomic<bool> blocked_;
+
+private:
+  RawBufferPtr rawBuffer_;
+};
+
+TEST(asctec_comm, Transport_ack_send_queue_full)
+{
+  LoopbackBridge bridge;
+  std::shared_ptr<BlockingBuffer> blocking(new BlockingBuffer(bridge.txRxLoopback_));
+  Transport pc(std::make_shared<DataLink>(blocking)), device(std::make_shared<DataLink>(bridge.rxTxLoopback_));
+  pc.setAckWindow(1000);
+
+  // more messages than the send queue holds, those that do not fit wait in the backlog instead of failing
+  std::vector<std::future<bool>> futures;
+  for(int i = 0; i < 300; ++i)
+  {
+    futures.push_back(pc.sendDataAcknowledgedAsync(seconds(5), 1, ByteVector(10, i)));
+  }
+  std::this_thread::sleep_for(milliseconds(20));
+  blocking->blocked_ = false;
+
+  for(auto& future : futures)
+  {
+    EXPECT_TRUE(future.get());
+  }
+  const AckStatistics statistics = pc.getAckStatistics();
+  EXPECT_EQ(300, statistics.messagesAcknowledged);
+  EXPECT_EQ(0, statistics.messagesFailed);
+}
+
+TEST(asctec_comm, Transport_test_ack_fun_with_threads)
 {
   SendReceiveTest test;
 
@@ -172,6 +310,314 @@ TEST(trinity_comm, Transport_test_ack_fun_with_threads)
   }
 }
 
+TEST(asctec_comm, Transport_send_struct)
+{
+  SendReceiveTest test;
+
+  for(int i = 0; i < nRuns; ++i)
+  {
+    Data data;
+    data.seq = i;
+    for(auto& d : data.payload)
+    {
+      d = rand();
+    }
+    test.pc_->sendData(1, data);
+
+    uint32_t id;
+    ByteVector datagram;
+    ASSERT_TRUE(test.device_->waitForData(milliseconds(100), &id, &datagram));
+    EXPECT_EQ(1, id);
+    ASSERT_EQ(sizeof(Data), datagram.size());
+    EXPECT_EQ(0, memcmp(&data, datagram.data(), sizeof(Data)));
+  }
+}
+
+TEST(asctec_comm, Transport_send_struct_order)
+{
+  SendReceiveTest test;
+
+  // structs must not overtake the vectors queued before them, whether they are written directly or queued as well
+  constexpr int nMessages = 90;
+  for(int i = 0; i < nMessages; ++i)
+  {
+    Data data;
+    data.seq = i;
+    if(i % 3 == 0)
+    {
+      EXPECT_TRUE(test.pc_->sendData(1, data));
+    }
+    else
+    {
+      EXPECT_TRUE(test.pc_->sendData(2, ByteVector(reinterpret_cast<uint8_t*>(&data),
+          reinterpret_cast<uint8_t*>(&data) + sizeof(Data))));
+    }
+  }
+
+  for(int i = 0; i < nMessages; ++i)
+  {
+    uint32_t id;
+    ByteVector datagram;
+    ASSERT_TRUE(test.device_->waitForData(milliseconds(100), &id, &datagram));
+    EXPECT_EQ(i % 3 == 0 ? 1 : 2, id);
+    ASSERT_EQ(sizeof(Data), datagram.size());
+    EXPECT_EQ(i, reinterpret_cast<const Data*>(datagram.data())->seq);
+  }
+}
+
+TEST(asctec_comm, Transport_retransmission_timing)
+{
+  // nobody acknowledges on the other side, so the message is sent maxAttempts times
+  LoopbackBridge bridge;
+  Transport transport(std::make_shared<DataLink>(bridge.txRxLoopback_));
+  DataLink receiver(bridge.rxTxLoopback_);
+
+  RetransmissionPolicy policy;
+  policy.initialTimeout = milliseconds(20);
+  policy.maxAttempts = 3;
+  transport.setRetransmissionPolicy(policy);
+
+  std::future<bool> acknowledged = transport.sendDataAcknowledgedAsync(milliseconds(1000), 1, ByteVector(10, 0x42));
+
+  std::vector<steady_clock::time_point> received;
+  const DataLink::FrameVisitor visitor = [&received](const uint8_t*, size_t, steady_clock::time_point timestamp)
+  {
+    received.push_back(timestamp);
+  };
+  const steady_clock::time_point timeout = steady_clock::now() + seconds(1);
+  while(received.size() < policy.maxAttempts && steady_clock::now() < timeout)
+  {
+    receiver.pollFrames(visitor);
+  }
+
+  // each retransmission doubles the timeout of the previous one
+  typedef duration<double, std::milli> Milliseconds;
+  ASSERT_EQ(policy.maxAttempts, received.size());
+  EXPECT_NEAR(20, duration_cast<Milliseconds>(received[1] - received[0]).count(), 5);
+  EXPECT_NEAR(40, duration_cast<Milliseconds>(received[2] - received[1]).count(), 5);
+
+  // gives up once the last transmission timed out, long before the caller's timeout
+  const steady_clock::time_point expectedFailure = received[2] + milliseconds(80);
+  EXPECT_EQ(std::future_status::ready, acknowledged.wait_until(expectedFailure + milliseconds(10)));
+  EXPECT_FALSE(acknowledged.get());
+}
+
+TEST(asctec_comm, Transport_rtt_excludes_send_queue)
+{
+  LoopbackBridge bridge;
+  std::shared_ptr<BlockingBuffer> blocking(new BlockingBuffer(bridge.txRxLoopback_));
+  Transport pc(std::make_shared<DataLink>(blocking)), device(std::make_shared<DataLink>(bridge.rxTxLoopback_));
+
+  // The datalink holds on to the first message until the link takes it. The acknowledged one waits behind it in the
+  // send queue far longer than the round trip takes.
+  EXPECT_TRUE(pc.sendData(2, ByteVector(10)));
+  std::this_thread::sleep_for(milliseconds(10));
+  std::future<bool> acknowledged = pc.sendDataAcknowledgedAsync(seconds(1), 1, ByteVector(10));
+  std::this_thread::sleep_for(milliseconds(100));
+  blocking->blocked_ = false;
+  ASSERT_TRUE(acknowledged.get());
+
+  const AckStatistics statistics = pc.getAckStatistics();
+  EXPECT_EQ(0, statistics.retransmissions);
+  EXPECT_GT(microseconds(50000), statistics.smoothedRtt);
+}
+
+TEST(asctec_comm, Transport_receive_timestamp)
+{
+  SendReceiveTest test;
+
+  const ByteVector data(10, 0x42);
+  const steady_clock::time_point timeSent = steady_clock::now();
+  test.pc_->sendData(1, data);
+
+  // the datagram waits in the receive queue, its timestamp must not
+  std::this_thread::sleep_for(milliseconds(50));
+  const steady_clock::time_point timeWait = steady_clock::now();
+
+  uint32_t id;
+  ByteVector datagram;
+  steady_clock::time_point timestamp;
+  ASSERT_TRUE(test.device_->waitForData(milliseconds(100), &id, &datagram, &timestamp));
+  EXPECT_EQ(data, datagram);
+  EXPECT_LE(timeSent, timestamp);
+  EXPECT_GE(timeWait, timestamp);
+}
+
+TEST(asctec_comm, Transport_max_frame_size)
+{
+  SendReceiveTest test(16384);
+  ASSERT_EQ(16384 - 8, test.pc_->getMaxDatagramSize());
+
+  ByteVector data(10000);
+  for(auto& d : data)
+  {
+    d = rand();
+  }
+
+  ASSERT_TRUE(test.pc_->sendData(1, data));
+
+  uint32_t id;
+  ByteVector datagram;
+  ASSERT_TRUE(test.device_->waitForData(milliseconds(100), &id, &datagram));
+  EXPECT_EQ(data, datagram);
+
+  // does not fit into the frames of a default link
+  SendReceiveTest small;
+  EXPECT_FALSE(small.pc_->sendData(1, data));
+  EXPECT_FALSE(small.device_->waitForData(milliseconds(50), &id, &datagram));
+}
+
+TEST(asctec_comm, Transport_delta_encoding)
+{
+  SendReceiveTest test;
+  test.pc_->setDeltaEncoding(1, 10);
+
+  for(int i = 0; i < nRuns; ++i)
+  {
+    Data data = Data();
+    data.seq = i;
+    data.payload[i % payloadSize] = rand();
+    test.pc_->sendData(1, data);
+
+    uint32_t id;
+    ByteVector datagram;
+    ASSERT_TRUE(test.device_->waitForData(milliseconds(100), &id, &datagram));
+    EXPECT_EQ(1, id);
+    ASSERT_EQ(sizeof(Data), datagram.size());
+    EXPECT_EQ(0, memcmp(&data, datagram.data(), sizeof(Data)));
+  }
+
+  // deltas are mostly zeros, the encoded frames are much smaller than the payload
+  const LinkStatistics statistics = test.dlPc_->getStatistics();
+  EXPECT_LT(statistics.bytesSent, statistics.framesSent * sizeof(Data) / 2);
+}
+
+TEST(asctec_comm, Transport_delta_encoding_old_peer)
+{
+  // the other side only runs a datalink and never answers keyframes, like a peer without delta decoding
+  LoopbackBridge bridge;
+  Transport transport(std::make_shared<DataLink>(bridge.txRxLoopback_));
+  DataLink peer(bridge.rxTxLoopback_);
+  transport.setDeltaEncoding(1, 10);
+
+  constexpr int nMessages = 20;
+  for(int i = 0; i < nMessages; ++i)
+  {
+    Data data = Data();
+    data.seq = i;
+    transport.sendData(1, data);
+
+    const steady_clock::time_point timeout = steady_clock::now() + milliseconds(100);
+    std::vector<ByteVector> frames;
+    while(frames.empty() && steady_clock::now() < timeout)
+    {
+      peer.pollFramesUnBuffered(&frames);
+    }
+    ASSERT_EQ(1, frames.size());
+
+    // full payloads only, an older peer takes them as they are
+    const ByteVector& frame = frames[0];
+    uint16_t flags;
+    memcpy(&flags, frame.data() + 4, sizeof(flags));
+    EXPECT_EQ(0, flags & delta::FLAG_DELTA);
+    ASSERT_EQ(8 + sizeof(Data), frame.size());
+    EXPECT_EQ(0, memcmp(&data, frame.data() + 8, sizeof(Data)));
+  }
+}
+
+TEST(asctec_comm, Transport_subscribe)
+{
+  SendReceiveTest test;
+  test.pc_->setDeltaEncoding(1, 10);
+
+  // id 1 on the receive thread
+  std::mutex mutex;
+  std::vector<ByteVector> received;
+  test.device_->subscribe(1, [&](uint32_t, const uint8_t* data, size_t size, steady_clock::time_point)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    received.emplace_back(data, data + size);
+  });
+
+  // id 2 through an executor that collects the tasks, run by this thread
+  ThreadSafeQueue<std::function<void()>> tasks(100);
+  std::vector<ByteVector> executed;
+  test.device_->subscribe(2, [&](uint32_t, const uint8_t* data, size_t size, steady_clock::time_point)
+  {
+    executed.emplace_back(data, data + size);
+  }, [&tasks](const std::function<void()>& task)
+  {
+    tasks.push(task);
+  });
+
+  std::vector<ByteVector> sent;
+  for(int i = 0; i < 10; ++i)
+  {
+    ByteVector data(20, 0);
+    data[i] = i;
+    sent.push_back(data);
+    test.pc_->sendData(1, data);
+    test.pc_->sendData(2, data);
+  }
+
+  for(int i = 0; i < 10; ++i)
+  {
+    std::function<void()> task;
+    ASSERT_TRUE(tasks.popWithTimeout(milliseconds(100), &task));
+    task();
+  }
+  EXPECT_EQ(sent, executed);
+
+  std::this_thread::sleep_for(milliseconds(10));
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    EXPECT_EQ(sent, received);
+  }
+
+  // subscribed ids never show up in the receive queue, the others still do unless turned off
+  uint32_t id;
+  ByteVector datagram;
+  test.pc_->sendData(3, sent[0]);
+  ASSERT_TRUE(test.device_->waitForData(milliseconds(100), &id, &datagram));
+  EXPECT_EQ(3, id);
+
+  test.device_->setQueueUnsubscribed(false);
+  test.pc_->sendData(3, sent[0]);
+  EXPECT_FALSE(test.device_->waitForData(milliseconds(50), &id, &datagram));
+
+  test.device_->unsubscribe(1);
+  test.device_->setQueueUnsubscribed(true);
+  test.pc_->sendData(1, sent[0]);
+  ASSERT_TRUE(test.device_->waitForData(milliseconds(100), &id, &datagram));
+  EXPECT_EQ(1, id);
+  EXPECT_EQ(sent[0], datagram);
+}
+
+TEST(asctec_comm, Transport_send_moved)
+{
+  SendReceiveTest test;
+
+  ByteVector data(100);
+  for(auto& d : data)
+  {
+    d = rand();
+  }
+  const ByteVector expected = data;
+
+  ASSERT_TRUE(test.pc_->sendData(1, std::move(data)));
+  EXPECT_TRUE(data.empty());
+
+  uint32_t id;
+  ByteVector datagram;
+  ASSERT_TRUE(test.device_->waitForData(milliseconds(100), &id, &datagram));
+  EXPECT_EQ(expected, datagram);
+
+  // a rejected buffer stays with the caller
+  SendReceiveTest small(64);
+  EXPECT_FALSE(small.pc_->sendData(1, std::move(datagram)));
+  EXPECT_EQ(expected, datagram);
+}
+
 int main(int argc, char **argv)
 {
   srand(12345678);